@@ -0,0 +1,114 @@
+//
+//  AhoCorasick.cpp
+//  SeekFS
+//
+#include "AhoCorasick.h"
+#include <queue>
+
+AhoCorasick::AhoCorasick(const std::vector<std::string>& patterns, bool case_sensitive)
+    : pattern_count_(patterns.size()), same_pattern_(patterns.size(), kNoOutput) {
+    for (int c = 0; c < 256; ++c) {
+        fold_[c] = (!case_sensitive && c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c + ('a' - 'A'))
+                                                             : static_cast<unsigned char>(c);
+    }
+
+    addState();
+
+    // Бор: переход в корень (0) на этом этапе означает "ребра нет"
+    for (size_t id = 0; id < patterns.size(); ++id) {
+        const auto& pattern = patterns[id];
+        if (pattern.empty()) {
+            empty_patterns_.push_back(static_cast<uint32_t>(id));
+            continue;
+        }
+
+        uint32_t state = 0;
+        for (unsigned char c : pattern) {
+            const unsigned char folded = fold_[c];
+            uint32_t next = transitions_[state * 256 + folded];
+            if (next == 0) {
+                next = addState();
+                transitions_[state * 256 + folded] = next;
+            }
+            state = next;
+        }
+
+        if (output_[state] == kNoOutput) {
+            output_[state] = static_cast<uint32_t>(id);
+        } else {
+            uint32_t last = output_[state];
+            while (same_pattern_[last] != kNoOutput) last = same_pattern_[last];
+            same_pattern_[last] = static_cast<uint32_t>(id);
+        }
+    }
+
+    // Обход в ширину: суффиксные ссылки сразу сворачиваются в полную таблицу переходов
+    std::vector<uint32_t> fail(output_.size(), 0);
+    std::queue<uint32_t> queue;
+    for (int c = 0; c < 256; ++c) {
+        const uint32_t child = transitions_[c];
+        if (child != 0) queue.push(child);
+    }
+
+    while (!queue.empty()) {
+        const uint32_t state = queue.front();
+        queue.pop();
+
+        const uint32_t link = fail[state];
+        output_link_[state] = (output_[link] != kNoOutput) ? link : output_link_[link];
+
+        for (int c = 0; c < 256; ++c) {
+            uint32_t& next = transitions_[state * 256 + c];
+            const uint32_t fallback = transitions_[link * 256 + c];
+            if (next != 0) {
+                fail[next] = fallback;
+                queue.push(next);
+            } else {
+                next = fallback;
+            }
+        }
+    }
+}
+
+uint32_t AhoCorasick::addState() {
+    transitions_.resize(transitions_.size() + 256, 0);
+    output_.push_back(kNoOutput);
+    output_link_.push_back(kNoOutput);
+    return static_cast<uint32_t>(output_.size() - 1);
+}
+
+size_t AhoCorasick::scan(const char* begin, const char* end, std::vector<char>& found) const {
+    size_t remaining = 0;
+    for (char f : found) {
+        if (!f) ++remaining;
+    }
+    if (remaining == 0) return 0;
+
+    size_t marked = 0;
+    auto mark = [&](uint32_t id) {
+        for (; id != kNoOutput; id = same_pattern_[id]) {
+            if (!found[id]) {
+                found[id] = 1;
+                ++marked;
+                --remaining;
+            }
+        }
+    };
+
+    for (uint32_t id : empty_patterns_) {
+        mark(id);
+    }
+
+    uint32_t state = 0;
+    for (const char* pos = begin; pos < end && remaining > 0; ++pos) {
+        state = transitions_[state * 256 + fold_[static_cast<unsigned char>(*pos)]];
+
+        uint32_t out = (output_[state] != kNoOutput) ? state : output_link_[state];
+        while (out != kNoOutput) {
+            mark(output_[out]);
+            out = output_link_[out];
+        }
+    }
+
+    return marked;
+}
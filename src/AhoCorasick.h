@@ -0,0 +1,35 @@
+//
+//  AhoCorasick.h
+//  SeekFS
+//
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Автомат Ахо-Корасик для одновременного поиска набора литералов за один
+// проход по данным. Переходы хранятся полной таблицей, так что на каждый
+// байт приходится ровно одно обращение к памяти.
+class AhoCorasick {
+public:
+    AhoCorasick(const std::vector<std::string>& patterns, bool case_sensitive);
+
+    size_t patternCount() const { return pattern_count_; }
+
+    // Отмечает в found найденные шаблоны (found.size() == patternCount()).
+    // Возвращает число новых отметок; останавливается, когда найдены все.
+    size_t scan(const char* begin, const char* end, std::vector<char>& found) const;
+
+private:
+    static constexpr uint32_t kNoOutput = UINT32_MAX;
+
+    size_t pattern_count_ = 0;
+    unsigned char fold_[256];
+    std::vector<uint32_t> transitions_;   // state * 256 + byte
+    std::vector<uint32_t> output_;        // шаблон, заканчивающийся в состоянии
+    std::vector<uint32_t> output_link_;   // ближайший суффикс с выходом
+    std::vector<uint32_t> same_pattern_;  // одинаковые шаблоны: id -> следующий id
+    std::vector<uint32_t> empty_patterns_;
+
+    uint32_t addState();
+};
@@ -0,0 +1,465 @@
+//
+//  AsyncReader.cpp
+//  SeekFS
+//
+#include "AsyncReader.h"
+#include <fstream>
+#include <algorithm>
+#include <memory>
+#include <cerrno>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SEEKFS_HAVE_PREAD 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(SEEKFS_IO_URING) && defined(__linux__)
+#define SEEKFS_HAVE_IO_URING 1
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include <cstring>
+#endif
+
+#if defined(SEEKFS_HAVE_IO_URING)
+// Кольца io_uring без liburing: только то, что нужно для READ_FIXED
+struct AsyncReader::Ring {
+    int fd = -1;
+    void* sq_ptr = MAP_FAILED;
+    void* cq_ptr = MAP_FAILED;
+    size_t sq_size = 0;
+    size_t cq_size = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_size = 0;
+
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    io_uring_cqe* cqes;
+    unsigned sq_entries = 0;
+    unsigned pending = 0; // подготовлено, но ещё не отдано ядру
+    size_t fail_after = SIZE_MAX; // injectRingFailure
+
+    ~Ring() {
+        if (sqes != MAP_FAILED) ::munmap(sqes, sqes_size);
+        if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) ::munmap(cq_ptr, cq_size);
+        if (sq_ptr != MAP_FAILED) ::munmap(sq_ptr, sq_size);
+        if (fd >= 0) ::close(fd);
+    }
+
+    bool setup(unsigned entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            return false;
+        }
+
+        sq_entries = params.sq_entries;
+        sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+            sq_size = cq_size = std::max(sq_size, cq_size);
+        }
+
+        sq_ptr = ::mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        fd, IORING_OFF_SQ_RING);
+        if (sq_ptr == MAP_FAILED) {
+            return false;
+        }
+        cq_ptr = single_mmap ? sq_ptr
+                             : ::mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                      fd, IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED) {
+            return false;
+        }
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                                                 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+
+        auto* sq = static_cast<char*>(sq_ptr);
+        auto* cq = static_cast<char*>(cq_ptr);
+        sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    bool registerBuffers(unsigned char* data, size_t count, size_t size) {
+        std::vector<iovec> iovecs(count);
+        for (size_t i = 0; i < count; ++i) {
+            iovecs[i].iov_base = data + i * size;
+            iovecs[i].iov_len = size;
+        }
+        return ::syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS,
+                         iovecs.data(), static_cast<unsigned>(count)) == 0;
+    }
+
+    void queueRead(int file_fd, unsigned char* buffer, unsigned length, uint64_t offset,
+                   uint16_t buffer_index, uint64_t user_data) {
+        const unsigned tail = *sq_tail;
+        const unsigned index = tail & *sq_mask;
+        io_uring_sqe& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READ_FIXED;
+        sqe.fd = file_fd;
+        sqe.addr = reinterpret_cast<uint64_t>(buffer);
+        sqe.len = length;
+        sqe.off = offset;
+        sqe.buf_index = buffer_index;
+        sqe.user_data = user_data;
+        sq_array[index] = index;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        ++pending;
+    }
+
+    // Отменяет запрос с данным user_data; false - в очереди нет места
+    bool queueCancel(uint64_t target, uint64_t user_data) {
+        const unsigned tail = *sq_tail;
+        if (tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+            return false;
+        }
+        const unsigned index = tail & *sq_mask;
+        io_uring_sqe& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_ASYNC_CANCEL;
+        sqe.fd = -1;
+        sqe.addr = target;
+        sqe.user_data = user_data;
+        sq_array[index] = index;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        ++pending;
+        return true;
+    }
+
+    // Отдаёт подготовленные запросы и ждёт хотя бы одно завершение
+    bool submitAndWait() {
+        if (fail_after != SIZE_MAX && fail_after-- == 0) {
+            errno = EIO;
+            return false;
+        }
+        while (true) {
+            const long rc = ::syscall(__NR_io_uring_enter, fd, pending, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (rc >= 0) {
+                pending -= static_cast<unsigned>(rc);
+                return true;
+            }
+            if (errno != EINTR) {
+                return false;
+            }
+        }
+    }
+
+    template<typename Func>
+    void drain(Func on_cqe) {
+        unsigned head = *cq_head;
+        const unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            on_cqe(cqes[head & *cq_mask]);
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+};
+#else
+struct AsyncReader::Ring {};
+#endif
+
+AsyncReader::AsyncReader(size_t queue_depth)
+    : queue_depth_(std::max<size_t>(1, queue_depth)) {
+#if defined(SEEKFS_HAVE_IO_URING)
+    buffer_.resize(queue_depth_ * kChunkSize);
+    auto ring = std::make_unique<Ring>();
+    if (ring->setup(static_cast<unsigned>(queue_depth_)) &&
+        ring->registerBuffers(buffer_.data(), queue_depth_, kChunkSize)) {
+        ring_ = ring.release();
+        return;
+    }
+#endif
+    // Без io_uring нужен один буфер на текущий файл
+    buffer_.assign(kChunkSize, 0);
+}
+
+AsyncReader::~AsyncReader() {
+    delete ring_;
+}
+
+bool AsyncReader::compiledWithIoUring() {
+#if defined(SEEKFS_HAVE_IO_URING)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AsyncReader::read(const Source& next, const ChunkCallback& on_chunk, const DoneCallback& on_done) {
+#if defined(SEEKFS_HAVE_IO_URING)
+    if (ring_) {
+        readWithRing(next, on_chunk, on_done);
+        return;
+    }
+#endif
+    readWithPread(next, on_chunk, on_done);
+}
+
+#if defined(SEEKFS_HAVE_PREAD)
+int AsyncReader::openFile(size_t id, const fs::path& path, uint64_t& size, Status& status) const {
+    status = Status::Failed;
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return -1;
+    }
+    size = static_cast<uint64_t>(st.st_size);
+    if (size > max_size_) {
+        status = Status::Skipped;
+        ::close(fd);
+        return -1;
+    }
+
+#if defined(POSIX_FADV_SEQUENTIAL)
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    status = Status::Ok;
+    if (on_open_) {
+        on_open_(id, size);
+    }
+    return fd;
+}
+
+void AsyncReader::readWithPread(const Source& next, const ChunkCallback& on_chunk, const DoneCallback& on_done) {
+    size_t id;
+    fs::path path;
+    while (next(id, path)) {
+        uint64_t size = 0;
+        Status status;
+        const int fd = openFile(id, path, size, status);
+        if (fd < 0) {
+            on_done(id, status);
+            continue;
+        }
+
+        status = readFrom(fd, id, 0, on_chunk);
+        ::close(fd);
+        on_done(id, status);
+    }
+}
+
+AsyncReader::Status AsyncReader::readFrom(int fd, size_t id, uint64_t offset, const ChunkCallback& on_chunk) {
+    while (true) {
+        const ssize_t n = ::pread(fd, buffer_.data(), buffer_.size(), static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return Status::Failed;
+        }
+        if (n == 0) return Status::Ok;
+        on_chunk(id, buffer_.data(), static_cast<size_t>(n));
+        offset += static_cast<uint64_t>(n);
+    }
+}
+#else
+void AsyncReader::readWithPread(const Source& next, const ChunkCallback& on_chunk, const DoneCallback& on_done) {
+    size_t id;
+    fs::path path;
+    while (next(id, path)) {
+        std::ifstream file(path, std::ios::binary);
+        std::error_code ec;
+        const uint64_t size = file.is_open() ? fs::file_size(path, ec) : 0;
+        if (!file.is_open() || ec) {
+            on_done(id, Status::Failed);
+            continue;
+        }
+        if (size > max_size_) {
+            on_done(id, Status::Skipped);
+            continue;
+        }
+        if (on_open_) {
+            on_open_(id, size);
+        }
+
+        char* data = reinterpret_cast<char*>(buffer_.data());
+        while (file.read(data, static_cast<std::streamsize>(buffer_.size())) || file.gcount() > 0) {
+            on_chunk(id, buffer_.data(), static_cast<size_t>(file.gcount()));
+        }
+        on_done(id, file.bad() ? Status::Failed : Status::Ok);
+    }
+}
+#endif
+
+#if defined(SEEKFS_HAVE_IO_URING)
+void AsyncReader::readWithRing(const Source& next, const ChunkCallback& on_chunk, const DoneCallback& on_done) {
+    // Слот - зарегистрированный буфер и файл, который в него читается
+    struct Slot {
+        size_t id = 0;
+        int fd = -1;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+    };
+    std::vector<Slot> slots(queue_depth_);
+    std::vector<size_t> free_slots;
+    for (size_t i = queue_depth_; i-- > 0;) {
+        free_slots.push_back(i);
+    }
+
+    auto submit = [&](size_t slot) {
+        ring_->queueRead(slots[slot].fd, buffer_.data() + slot * kChunkSize, kChunkSize,
+                         slots[slot].offset, static_cast<uint16_t>(slot), slot);
+    };
+
+    auto finish = [&](size_t slot, Status status) {
+        ::close(slots[slot].fd);
+        slots[slot].fd = -1;
+        free_slots.push_back(slot);
+        on_done(slots[slot].id, status);
+    };
+
+    bool exhausted = false;
+    size_t in_flight = 0;
+    while (true) {
+        // Свободные слоты сразу получают новые файлы
+        while (!exhausted && !free_slots.empty()) {
+            size_t id;
+            fs::path path;
+            if (!next(id, path)) {
+                exhausted = true;
+                break;
+            }
+
+            uint64_t size = 0;
+            Status status;
+            const int fd = openFile(id, path, size, status);
+            if (fd < 0) {
+                on_done(id, status);
+                continue;
+            }
+            if (size == 0) {
+                ::close(fd);
+                on_done(id, Status::Ok);
+                continue;
+            }
+
+            const size_t slot = free_slots.back();
+            free_slots.pop_back();
+            slots[slot] = Slot{id, fd, 0, size};
+            submit(slot);
+            ++in_flight;
+        }
+
+        if (in_flight == 0) {
+            return;
+        }
+
+        if (!ring_->submitAndWait()) {
+            // Кольцо сломалось: файлы в полёте дочитываются через pread с
+            // последнего полученного куска, остальные - обычным порядком
+            std::vector<char> awaiting(slots.size(), 0);
+            for (size_t slot = 0; slot < slots.size(); ++slot) {
+                awaiting[slot] = slots[slot].fd >= 0;
+            }
+            shutdownRing(awaiting, in_flight);
+            for (size_t slot = 0; slot < slots.size(); ++slot) {
+                if (slots[slot].fd >= 0) {
+                    const Status status = readFrom(slots[slot].fd, slots[slot].id, slots[slot].offset, on_chunk);
+                    finish(slot, status);
+                }
+            }
+            readWithPread(next, on_chunk, on_done);
+            return;
+        }
+
+        ring_->drain([&](const io_uring_cqe& cqe) {
+            const size_t slot = static_cast<size_t>(cqe.user_data);
+            if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                submit(slot);
+                return;
+            }
+            if (cqe.res < 0) {
+                --in_flight;
+                finish(slot, Status::Failed);
+                return;
+            }
+            if (cqe.res == 0) {
+                --in_flight;
+                finish(slot, Status::Ok);
+                return;
+            }
+
+            on_chunk(slots[slot].id, buffer_.data() + slot * kChunkSize, static_cast<size_t>(cqe.res));
+            slots[slot].offset += static_cast<uint64_t>(cqe.res);
+            // Размер известен по fstat, лишний запрос ради EOF не нужен
+            if (slots[slot].offset >= slots[slot].size) {
+                --in_flight;
+                finish(slot, Status::Ok);
+                return;
+            }
+            submit(slot);
+        });
+    }
+}
+
+void AsyncReader::shutdownRing(std::vector<char>& awaiting, size_t outstanding) {
+    // Закрытие кольца не ждёт чтений в полёте, а они пишут в
+    // зарегистрированные буферы. Поэтому сначала запросы отменяются и все
+    // завершения собираются, и только потом буферы можно отдать куче
+    constexpr uint64_t kCancelTag = UINT64_MAX;
+    for (size_t slot = 0; slot < awaiting.size(); ++slot) {
+        if (awaiting[slot]) {
+            ring_->queueCancel(slot, kCancelTag);
+        }
+    }
+
+    for (size_t attempt = 0; outstanding > 0 && attempt < kShutdownAttempts; ++attempt) {
+        ring_->drain([&](const io_uring_cqe& cqe) {
+            if (cqe.user_data != kCancelTag && awaiting[cqe.user_data]) {
+                awaiting[cqe.user_data] = 0;
+                --outstanding;
+            }
+        });
+        if (outstanding > 0 && !ring_->submitAndWait()) {
+            break;
+        }
+    }
+
+    delete ring_;
+    ring_ = nullptr;
+    if (outstanding > 0) {
+        // Собрать завершения не удалось: буферы остаются за ядром до конца процесса
+        new std::vector<unsigned char>(std::move(buffer_));
+    }
+    buffer_.assign(kChunkSize, 0);
+}
+#else
+void AsyncReader::readWithRing(const Source& next, const ChunkCallback& on_chunk, const DoneCallback& on_done) {
+    readWithPread(next, on_chunk, on_done);
+}
+#endif
+
+void AsyncReader::injectRingFailure(size_t waits) {
+#if defined(SEEKFS_HAVE_IO_URING)
+    if (ring_) {
+        ring_->fail_after = waits;
+    }
+#else
+    (void)waits;
+#endif
+}
@@ -0,0 +1,75 @@
+//
+//  AsyncReader.h
+//  SeekFS
+//
+#pragma once
+#include <vector>
+#include <filesystem>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+namespace fs = std::filesystem;
+
+// Последовательное чтение многих файлов с несколькими запросами в полёте.
+// При сборке с SEEKFS_IO_URING чтение идёт через io_uring с
+// зарегистрированными буферами: одновременно читается до queue_depth файлов,
+// у каждого не больше одного запроса, поэтому куски одного файла приходят
+// по порядку. Без io_uring (или если ядро его не дает) файлы читаются
+// по очереди через pread.
+//
+// Все обратные вызовы выполняются в потоке, вызвавшем read(). Один
+// экземпляр принадлежит одному потоку.
+class AsyncReader {
+public:
+    static constexpr size_t kChunkSize = 128 * 1024;
+    static constexpr size_t kQueueDepth = 16;
+    // Столько ожиданий даётся кольцу, чтобы вернуть отменённые чтения
+    static constexpr size_t kShutdownAttempts = 64;
+
+    enum class Status {
+        Ok,
+        Failed,   // не открылся или ошибка чтения
+        Skipped   // больше max_size
+    };
+
+    // Следующий файл: false - файлы закончились
+    using Source = std::function<bool(size_t& id, fs::path& path)>;
+    using ChunkCallback = std::function<void(size_t id, const unsigned char* data, size_t size)>;
+    // size - размер файла по fstat; вызывается до первого куска
+    using OpenCallback = std::function<void(size_t id, uint64_t size)>;
+    using DoneCallback = std::function<void(size_t id, Status status)>;
+
+    explicit AsyncReader(size_t queue_depth = kQueueDepth);
+    ~AsyncReader();
+
+    AsyncReader(const AsyncReader&) = delete;
+    AsyncReader& operator=(const AsyncReader&) = delete;
+
+    // Собран ли io_uring; движок всё равно может откатиться на pread
+    static bool compiledWithIoUring();
+    bool usingIoUring() const { return ring_ != nullptr; }
+
+    void setMaxSize(uint64_t max_size) { max_size_ = max_size; }
+    // Для тестов: ожидание завершений номер waits (с нуля) сообщит об
+    // ошибке кольца, как при сбое io_uring_enter
+    void injectRingFailure(size_t waits);
+    void setOpenCallback(OpenCallback on_open) { on_open_ = std::move(on_open); }
+
+    void read(const Source& next, const ChunkCallback& on_chunk, const DoneCallback& on_done);
+
+private:
+    struct Ring;
+
+    size_t queue_depth_;
+    uint64_t max_size_ = UINT64_MAX;
+    OpenCallback on_open_;
+    Ring* ring_ = nullptr;
+    std::vector<unsigned char> buffer_;
+
+    int openFile(size_t id, const fs::path& path, uint64_t& size, Status& status) const;
+    Status readFrom(int fd, size_t id, uint64_t offset, const ChunkCallback& on_chunk);
+    void shutdownRing(std::vector<char>& awaiting, size_t outstanding);
+    void readWithPread(const Source& next, const ChunkCallback& on_chunk, const DoneCallback& on_done);
+    void readWithRing(const Source& next, const ChunkCallback& on_chunk, const DoneCallback& on_done);
+};
@@ -0,0 +1,170 @@
+//
+//  AtomicFile.cpp
+//  SeekFS
+//
+#include "AtomicFile.h"
+#include <random>
+#include <string>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SEEKFS_HAVE_POSIX_FILES 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cerrno>
+#endif
+
+#if defined(SEEKFS_HAVE_POSIX_FILES)
+namespace {
+    // umask можно прочитать, только сменив его; делается это один раз при
+    // статической инициализации, пока других потоков ещё нет
+    mode_t readUmask() {
+        const mode_t mask = ::umask(0);
+        ::umask(mask);
+        return mask;
+    }
+
+    const mode_t kProcessUmask = readUmask();
+}
+#endif
+
+AtomicFile::AtomicFile(fs::path target) : target_(std::move(target)) {
+    std::error_code ec;
+    if (target_.has_parent_path()) {
+        fs::create_directories(target_.parent_path(), ec);
+    }
+
+#if defined(SEEKFS_HAVE_POSIX_FILES)
+    std::string pattern = target_.string() + ".XXXXXX";
+    fd_ = ::mkstemp(pattern.data());
+    if (fd_ < 0) {
+        failed_ = true;
+        return;
+    }
+    // mkstemp создаёт файл с правами 0600. Заменяемый файл сохраняет свои
+    // права, новый получает их как от обычного open с учётом umask
+    struct stat existing;
+    const mode_t mode = ::stat(target_.c_str(), &existing) == 0
+        ? (existing.st_mode & 07777)
+        : (0666 & ~kProcessUmask);
+    ::fchmod(fd_, mode);
+    temp_ = pattern;
+#else
+    std::random_device random;
+    temp_ = target_;
+    temp_ += "." + std::to_string(random()) + ".tmp";
+    stream_.open(temp_, std::ios::binary | std::ios::trunc);
+    if (!stream_) {
+        failed_ = true;
+        return;
+    }
+#endif
+    buffer_.reserve(kBufferSize);
+}
+
+AtomicFile::~AtomicFile() {
+    discard();
+}
+
+void AtomicFile::discard() {
+#if defined(SEEKFS_HAVE_POSIX_FILES)
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+#else
+    if (stream_.is_open()) {
+        stream_.close();
+    }
+#endif
+    if (!temp_.empty()) {
+        std::error_code ec;
+        fs::remove(temp_, ec);
+        temp_.clear();
+    }
+}
+
+void AtomicFile::write(const void* data, size_t size) {
+    if (failed_) {
+        return;
+    }
+    const char* bytes = static_cast<const char*>(data);
+    if (buffer_.size() + size > kBufferSize && !flushBuffer()) {
+        return;
+    }
+    if (size >= kBufferSize) {
+        buffer_.assign(bytes, bytes + size);
+        flushBuffer();
+        return;
+    }
+    buffer_.insert(buffer_.end(), bytes, bytes + size);
+}
+
+bool AtomicFile::flushBuffer() {
+#if defined(SEEKFS_HAVE_POSIX_FILES)
+    const char* pos = buffer_.data();
+    size_t left = buffer_.size();
+    while (left > 0) {
+        const ssize_t written = ::write(fd_, pos, left);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            failed_ = true;
+            return false;
+        }
+        pos += written;
+        left -= static_cast<size_t>(written);
+    }
+#else
+    stream_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    if (!stream_) {
+        failed_ = true;
+        return false;
+    }
+#endif
+    buffer_.clear();
+    return true;
+}
+
+bool AtomicFile::commit() {
+    if (failed_ || temp_.empty() || !flushBuffer()) {
+        discard();
+        return false;
+    }
+
+#if defined(SEEKFS_HAVE_POSIX_FILES)
+    // Без fsync после сбоя питания rename мог бы оставить пустой файл
+    const bool synced = ::fsync(fd_) == 0;
+    const bool closed = ::close(fd_) == 0;
+    fd_ = -1;
+    if (!synced || !closed) {
+        discard();
+        return false;
+    }
+#else
+    stream_.close();
+    if (stream_.fail()) {
+        discard();
+        return false;
+    }
+#endif
+
+    std::error_code ec;
+    fs::rename(temp_, target_, ec);
+    if (ec) {
+        discard();
+        return false;
+    }
+    temp_.clear();
+
+#if defined(SEEKFS_HAVE_POSIX_FILES)
+    // Сам rename становится постоянным после fsync директории
+    const fs::path dir = target_.has_parent_path() ? target_.parent_path() : fs::path(".");
+    const int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+#endif
+    return true;
+}
@@ -0,0 +1,45 @@
+//
+//  AtomicFile.h
+//  SeekFS
+//
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include <cstddef>
+
+namespace fs = std::filesystem;
+
+// Замена файла целиком: данные пишутся в уникальный временный файл рядом
+// с целью, который после fsync переименовывается поверх неё. Несколько
+// процессов, пишущих один и тот же файл, не портят записи друг друга:
+// побеждает последний rename, а читатель видит старый или новый файл целиком.
+class AtomicFile {
+public:
+    explicit AtomicFile(fs::path target);
+    ~AtomicFile();   // без commit временный файл удаляется
+
+    AtomicFile(const AtomicFile&) = delete;
+    AtomicFile& operator=(const AtomicFile&) = delete;
+
+    // Ошибки запоминаются и возвращаются из commit
+    void write(const void* data, size_t size);
+    template<typename T>
+    void writeValue(const T& value) { write(&value, sizeof(T)); }
+
+    // false - не удалось записать, цель не тронута
+    bool commit();
+
+private:
+    static constexpr size_t kBufferSize = 1 << 20;
+
+    fs::path target_;
+    fs::path temp_;
+    int fd_ = -1;
+    std::ofstream stream_;     // без POSIX вместо fd_
+    bool failed_ = false;
+    std::vector<char> buffer_;
+
+    bool flushBuffer();
+    void discard();
+};
@@ -0,0 +1,322 @@
+//
+//  BLAKE3.cpp
+//  SeekFS
+//
+#include "BLAKE3.h"
+#include <cstring>
+#include <array>
+#include <algorithm>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Раунды должны раскрываться полностью: иначе состояние не помещается в регистры
+#if defined(__GNUC__)
+#define BLAKE3_INLINE __attribute__((always_inline)) inline
+#else
+#define BLAKE3_INLINE inline
+#endif
+
+namespace {
+    constexpr uint32_t IV[8] = {
+        0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+        0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+    };
+
+    constexpr uint32_t CHUNK_START = 1 << 0;
+    constexpr uint32_t CHUNK_END = 1 << 1;
+    constexpr uint32_t PARENT = 1 << 2;
+    constexpr uint32_t ROOT = 1 << 3;
+
+    constexpr size_t kRounds = 7;
+    constexpr size_t kBlocksPerChunk = BLAKE3::kChunkLength / BLAKE3::kBlockLength;
+
+    // Порядок слов сообщения в каждом раунде: перестановка применяется
+    // к предыдущему раунду, поэтому расписание считается заранее
+    constexpr std::array<std::array<uint8_t, 16>, kRounds> makeSchedule() {
+        constexpr uint8_t permutation[16] = {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8};
+        std::array<std::array<uint8_t, 16>, kRounds> schedule{};
+        for (uint8_t i = 0; i < 16; ++i) schedule[0][i] = i;
+        for (size_t r = 1; r < kRounds; ++r) {
+            for (size_t i = 0; i < 16; ++i) {
+                schedule[r][i] = schedule[r - 1][permutation[i]];
+            }
+        }
+        return schedule;
+    }
+
+    constexpr auto kSchedule = makeSchedule();
+
+    template<int N>
+    uint32_t rotr(uint32_t x) {
+        return (x >> N) | (x << (32 - N));
+    }
+
+#if defined(__SSE2__)
+    // Четыре независимых 32-битных слова, по одному на компрессию
+    struct Lanes {
+        __m128i v;
+    };
+
+    Lanes operator+(Lanes a, Lanes b) { return {_mm_add_epi32(a.v, b.v)}; }
+    Lanes operator^(Lanes a, Lanes b) { return {_mm_xor_si128(a.v, b.v)}; }
+
+    template<int N>
+    Lanes rotr(Lanes x) {
+        return {_mm_or_si128(_mm_srli_epi32(x.v, N), _mm_slli_epi32(x.v, 32 - N))};
+    }
+#endif
+
+    template<typename W>
+    BLAKE3_INLINE void g(W* v, size_t a, size_t b, size_t c, size_t d, W mx, W my) {
+        v[a] = v[a] + v[b] + mx;
+        v[d] = rotr<16>(v[d] ^ v[a]);
+        v[c] = v[c] + v[d];
+        v[b] = rotr<12>(v[b] ^ v[c]);
+        v[a] = v[a] + v[b] + my;
+        v[d] = rotr<8>(v[d] ^ v[a]);
+        v[c] = v[c] + v[d];
+        v[b] = rotr<7>(v[b] ^ v[c]);
+    }
+
+    template<typename W, size_t R>
+    BLAKE3_INLINE void round(W* v, const W* m) {
+        constexpr const auto& s = kSchedule[R];
+        g(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+        g(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+        g(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+        g(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+        g(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+        g(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+        g(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+        g(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+    }
+
+    template<typename W, size_t... R>
+    BLAKE3_INLINE void permuteRounds(W* v, const W* m, std::index_sequence<R...>) {
+        (round<W, R>(v, m), ...);
+    }
+
+    // Семь раундов над состоянием v; одинаково для скаляра и SIMD-полос
+    template<typename W>
+    BLAKE3_INLINE void permuteRounds(W* v, const W* m) {
+        permuteRounds(v, m, std::make_index_sequence<kRounds>());
+    }
+
+    void loadWords(const unsigned char* block, uint32_t* words) {
+        for (size_t i = 0; i < 16; ++i) {
+            words[i] = static_cast<uint32_t>(block[4 * i]) |
+                       (static_cast<uint32_t>(block[4 * i + 1]) << 8) |
+                       (static_cast<uint32_t>(block[4 * i + 2]) << 16) |
+                       (static_cast<uint32_t>(block[4 * i + 3]) << 24);
+        }
+    }
+
+    void compress(const uint32_t cv[8], const uint32_t block[16], uint64_t counter,
+                  uint32_t block_length, uint32_t flags, uint32_t out[16]) {
+        uint32_t v[16] = {
+            cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+            IV[0], IV[1], IV[2], IV[3],
+            static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32),
+            block_length, flags
+        };
+        permuteRounds(v, block);
+        for (size_t i = 0; i < 8; ++i) {
+            out[i] = v[i] ^ v[i + 8];
+            out[i + 8] = v[i + 8] ^ cv[i];
+        }
+    }
+
+    void compressChunk(const unsigned char* chunk, uint64_t counter, uint32_t cv[8]) {
+        std::memcpy(cv, IV, sizeof(IV));
+        uint32_t words[16];
+        uint32_t out[16];
+        for (size_t b = 0; b < kBlocksPerChunk; ++b) {
+            loadWords(chunk + b * BLAKE3::kBlockLength, words);
+            const uint32_t flags = (b == 0 ? CHUNK_START : 0) | (b + 1 == kBlocksPerChunk ? CHUNK_END : 0);
+            compress(cv, words, counter, BLAKE3::kBlockLength, flags, out);
+            std::memcpy(cv, out, 8 * sizeof(uint32_t));
+        }
+    }
+
+#if defined(__SSE2__)
+    // Четыре соседних чанка за раз: полоса i отвечает за чанк i
+    void compressChunks4(const unsigned char* chunks, uint64_t counter, uint32_t cvs[4][8]) {
+        Lanes cv[8];
+        for (size_t i = 0; i < 8; ++i) {
+            cv[i].v = _mm_set1_epi32(static_cast<int>(IV[i]));
+        }
+
+        const __m128i counter_lo = _mm_set_epi32(static_cast<int>(counter + 3), static_cast<int>(counter + 2),
+                                                 static_cast<int>(counter + 1), static_cast<int>(counter));
+        const __m128i counter_hi = _mm_set_epi32(static_cast<int>((counter + 3) >> 32), static_cast<int>((counter + 2) >> 32),
+                                                 static_cast<int>((counter + 1) >> 32), static_cast<int>(counter >> 32));
+
+        Lanes m[16];
+        for (size_t b = 0; b < kBlocksPerChunk; ++b) {
+            // Транспонирование 4x4: слово k блока b из каждого чанка в свою полосу
+            for (size_t q = 0; q < 4; ++q) {
+                const size_t offset = b * BLAKE3::kBlockLength + 16 * q;
+                const __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chunks + offset));
+                const __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chunks + BLAKE3::kChunkLength + offset));
+                const __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chunks + 2 * BLAKE3::kChunkLength + offset));
+                const __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chunks + 3 * BLAKE3::kChunkLength + offset));
+                const __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+                const __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+                const __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+                const __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+                m[4 * q].v = _mm_unpacklo_epi64(t0, t1);
+                m[4 * q + 1].v = _mm_unpackhi_epi64(t0, t1);
+                m[4 * q + 2].v = _mm_unpacklo_epi64(t2, t3);
+                m[4 * q + 3].v = _mm_unpackhi_epi64(t2, t3);
+            }
+
+            const uint32_t flags = (b == 0 ? CHUNK_START : 0) | (b + 1 == kBlocksPerChunk ? CHUNK_END : 0);
+            Lanes v[16] = {
+                cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+                {_mm_set1_epi32(static_cast<int>(IV[0]))}, {_mm_set1_epi32(static_cast<int>(IV[1]))},
+                {_mm_set1_epi32(static_cast<int>(IV[2]))}, {_mm_set1_epi32(static_cast<int>(IV[3]))},
+                {counter_lo}, {counter_hi},
+                {_mm_set1_epi32(static_cast<int>(BLAKE3::kBlockLength))}, {_mm_set1_epi32(static_cast<int>(flags))}
+            };
+            permuteRounds(v, m);
+            for (size_t i = 0; i < 8; ++i) {
+                cv[i] = v[i] ^ v[i + 8];
+            }
+        }
+
+        alignas(16) uint32_t lanes[8][4];
+        for (size_t i = 0; i < 8; ++i) {
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes[i]), cv[i].v);
+        }
+        for (size_t chunk = 0; chunk < 4; ++chunk) {
+            for (size_t i = 0; i < 8; ++i) {
+                cvs[chunk][i] = lanes[i][chunk];
+            }
+        }
+    }
+#endif
+
+    void parentChainingValue(const uint32_t left[8], const uint32_t right[8], uint32_t flags, uint32_t out[16]) {
+        uint32_t block[16];
+        std::memcpy(block, left, 8 * sizeof(uint32_t));
+        std::memcpy(block + 8, right, 8 * sizeof(uint32_t));
+        compress(IV, block, 0, BLAKE3::kBlockLength, PARENT | flags, out);
+    }
+}
+
+BLAKE3::BLAKE3() = default;
+
+void BLAKE3::addChunkChainingValue(const uint32_t cv[8]) {
+    // Каждый завершённый чанк сливается с левыми соседями, пока их число
+    // чётно: в стеке остаётся по одному поддереву на каждый единичный бит
+    uint32_t merged[16];
+    std::memcpy(merged, cv, 8 * sizeof(uint32_t));
+    uint64_t total = ++chunk_counter_;
+    while ((total & 1) == 0) {
+        parentChainingValue(cv_stack_[--cv_stack_size_], merged, 0, merged);
+        total >>= 1;
+    }
+    std::memcpy(cv_stack_[cv_stack_size_++], merged, 8 * sizeof(uint32_t));
+}
+
+void BLAKE3::compressFullChunks(const unsigned char* input, size_t chunks) {
+    uint32_t cv[8];
+#if defined(__SSE2__)
+    for (; chunks >= 4; chunks -= 4, input += 4 * kChunkLength) {
+        uint32_t cvs[4][8];
+        compressChunks4(input, chunk_counter_, cvs);
+        for (const auto& chunk_cv : cvs) {
+            addChunkChainingValue(chunk_cv);
+        }
+    }
+#endif
+    for (; chunks > 0; --chunks, input += kChunkLength) {
+        compressChunk(input, chunk_counter_, cv);
+        addChunkChainingValue(cv);
+    }
+}
+
+void BLAKE3::update(const unsigned char* data, size_t length) {
+    constexpr size_t batch = kBatchChunks * kChunkLength;
+
+    // Пока за пачкой гарантированно есть ещё данные, сжимаем прямо из входа
+    if (pending_size_ == 0) {
+        while (length > batch) {
+            compressFullChunks(data, kBatchChunks);
+            data += batch;
+            length -= batch;
+        }
+    }
+
+    while (length > 0) {
+        const size_t take = std::min(length, sizeof(pending_) - pending_size_);
+        std::memcpy(pending_ + pending_size_, data, take);
+        pending_size_ += take;
+        data += take;
+        length -= take;
+
+        if (pending_size_ > batch) {
+            compressFullChunks(pending_, kBatchChunks);
+            pending_size_ -= batch;
+            std::memmove(pending_, pending_ + batch, pending_size_);
+        }
+    }
+}
+
+Digest BLAKE3::finalize() {
+    // Все чанки, кроме последнего, полные; последний может быть пустым
+    // только у пустого входа
+    const size_t full_chunks = pending_size_ == 0 ? 0 : (pending_size_ - 1) / kChunkLength;
+    compressFullChunks(pending_, full_chunks);
+
+    const unsigned char* chunk = pending_ + full_chunks * kChunkLength;
+    const size_t chunk_length = pending_size_ - full_chunks * kChunkLength;
+    const size_t blocks = chunk_length == 0 ? 1 : (chunk_length + kBlockLength - 1) / kBlockLength;
+
+    uint32_t cv[8];
+    std::memcpy(cv, IV, sizeof(IV));
+    uint32_t words[16];
+    uint32_t out[16];
+    for (size_t b = 0; b + 1 < blocks; ++b) {
+        loadWords(chunk + b * kBlockLength, words);
+        compress(cv, words, chunk_counter_, kBlockLength, b == 0 ? CHUNK_START : 0, out);
+        std::memcpy(cv, out, 8 * sizeof(uint32_t));
+    }
+
+    // Последний блок чанка; он же корень, если чанк единственный
+    unsigned char last_block[kBlockLength] = {};
+    const size_t last_length = chunk_length - (blocks - 1) * kBlockLength;
+    std::memcpy(last_block, chunk + (blocks - 1) * kBlockLength, last_length);
+
+    uint32_t node_cv[8];
+    uint32_t node_block[16];
+    uint64_t node_counter = chunk_counter_;
+    uint32_t node_length = static_cast<uint32_t>(last_length);
+    uint32_t node_flags = (blocks == 1 ? CHUNK_START : 0) | CHUNK_END;
+    std::memcpy(node_cv, cv, sizeof(node_cv));
+    loadWords(last_block, node_block);
+
+    while (cv_stack_size_ > 0) {
+        compress(node_cv, node_block, node_counter, node_length, node_flags, out);
+        std::memcpy(node_block, cv_stack_[--cv_stack_size_], 8 * sizeof(uint32_t));
+        std::memcpy(node_block + 8, out, 8 * sizeof(uint32_t));
+        std::memcpy(node_cv, IV, sizeof(node_cv));
+        node_counter = 0;
+        node_length = kBlockLength;
+        node_flags = PARENT;
+    }
+
+    compress(node_cv, node_block, node_counter, node_length, node_flags | ROOT, out);
+
+    unsigned char bytes[32];
+    for (size_t i = 0; i < 8; ++i) {
+        bytes[4 * i] = static_cast<unsigned char>(out[i]);
+        bytes[4 * i + 1] = static_cast<unsigned char>(out[i] >> 8);
+        bytes[4 * i + 2] = static_cast<unsigned char>(out[i] >> 16);
+        bytes[4 * i + 3] = static_cast<unsigned char>(out[i] >> 24);
+    }
+    return Digest(bytes, sizeof(bytes));
+}
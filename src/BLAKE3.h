@@ -0,0 +1,38 @@
+//
+//  BLAKE3.h
+//  SeekFS
+//
+#pragma once
+#include "Hasher.h"
+#include <cstdint>
+
+// BLAKE3 с 256-битным выходом. Вход делится на чанки по 1 КБ, их
+// хэши сворачиваются в двоичное дерево через стек цепочечных значений.
+// Полностью заполненные чанки, накопленные в буфере, сжимаются пачкой
+// по четыре: на x86 четыре компрессии идут параллельно в SSE2-регистрах.
+class BLAKE3 : public Hasher {
+public:
+    BLAKE3();
+    void update(const unsigned char* data, size_t length) override;
+    Digest finalize() override;
+    std::unique_ptr<Hasher> clone() const override { return std::make_unique<BLAKE3>(*this); }
+
+    static constexpr size_t kChunkLength = 1024;
+    static constexpr size_t kBlockLength = 64;
+
+private:
+    static constexpr size_t kMaxDepth = 54;
+    static constexpr size_t kBatchChunks = 4;
+
+    uint32_t cv_stack_[kMaxDepth][8];
+    size_t cv_stack_size_ = 0;
+    uint64_t chunk_counter_ = 0;
+
+    // Незавершённые данные: до kBatchChunks полных чанков и последний чанк.
+    // Последний чанк не сжимается, пока не ясно, что за ним есть ещё данные
+    unsigned char pending_[kBatchChunks * kChunkLength + kChunkLength];
+    size_t pending_size_ = 0;
+
+    void addChunkChainingValue(const uint32_t cv[8]);
+    void compressFullChunks(const unsigned char* input, size_t chunks);
+};
@@ -0,0 +1,59 @@
+//
+//  ContentChunker.cpp
+//  SeekFS
+//
+#include "ContentChunker.h"
+#include <array>
+
+namespace {
+    constexpr uint64_t splitmix64(uint64_t& state) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    constexpr std::array<uint64_t, 256> makeGear() {
+        std::array<uint64_t, 256> gear{};
+        uint64_t state = 0x5EEDF5C0DEC0FFEEull;
+        for (auto& value : gear) {
+            value = splitmix64(state);
+        }
+        return gear;
+    }
+
+    constexpr std::array<uint64_t, 256> kGear = makeGear();
+
+    // Сдвиг влево оставляет в старших битах влияние последних 64 байт,
+    // поэтому маски берутся из старших битов. log2(kAvgSize) = 14
+    constexpr uint64_t highBits(unsigned count) {
+        return ~0ull << (64 - count);
+    }
+    constexpr uint64_t kMaskStrict = highBits(16);
+    constexpr uint64_t kMaskLoose = highBits(12);
+}
+
+size_t ContentChunker::nextChunk(const unsigned char* data, size_t size) {
+    if (size <= kMinSize) {
+        return size;
+    }
+
+    const size_t limit = size < kMaxSize ? size : kMaxSize;
+    const size_t normal = size < kAvgSize ? size : kAvgSize;
+
+    uint64_t hash = 0;
+    size_t i = kMinSize;
+    for (; i < normal; ++i) {
+        hash = (hash << 1) + kGear[data[i]];
+        if (!(hash & kMaskStrict)) {
+            return i + 1;
+        }
+    }
+    for (; i < limit; ++i) {
+        hash = (hash << 1) + kGear[data[i]];
+        if (!(hash & kMaskLoose)) {
+            return i + 1;
+        }
+    }
+    return limit;
+}
@@ -0,0 +1,22 @@
+//
+//  ContentChunker.h
+//  SeekFS
+//
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Нарезка на чанки по содержимому в духе FastCDC: границы ставит
+// скользящий gear-хэш, поэтому вставка в начало файла сдвигает только
+// соседние границы, а остальные чанки совпадают с прежними. До среднего
+// размера используется более строгая маска, после - более мягкая,
+// чтобы размеры собирались вокруг kAvgSize.
+class ContentChunker {
+public:
+    static constexpr size_t kMinSize = 4 * 1024;
+    static constexpr size_t kAvgSize = 16 * 1024;
+    static constexpr size_t kMaxSize = 64 * 1024;
+
+    // Длина чанка, начинающегося с data; size - сколько данных осталось
+    static size_t nextChunk(const unsigned char* data, size_t size);
+};
@@ -0,0 +1,290 @@
+//
+//  ContentIndex.cpp
+//  SeekFS
+//
+#include "ContentIndex.h"
+#include "AtomicFile.h"
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SEEKFS_HAVE_MMAP 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+    constexpr char kMagic[8] = {'S', 'K', 'F', 'S', 'C', 'I', '0', '1'};
+
+    struct Header {
+        char magic[8];
+        uint64_t file_count;
+        uint64_t trigram_count;
+        uint64_t postings_size;
+        uint64_t blob_size;
+    };
+
+    unsigned char foldByte(unsigned char byte) {
+        return byte >= 'A' && byte <= 'Z' ? static_cast<unsigned char>(byte + ('a' - 'A')) : byte;
+    }
+
+    size_t padTo8(size_t size) {
+        return (size + 7) & ~size_t(7);
+    }
+
+    void appendVarint(std::string& out, uint32_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+}
+
+ContentIndex::TrigramCollector::TrigramCollector() : seen_((1u << 24) / 64) {}
+
+const std::vector<uint32_t>& ContentIndex::TrigramCollector::collect(const char* data, size_t size) {
+    trigrams_.clear();
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+
+    uint32_t trigram = 0;
+    for (size_t i = 0; i < size; ++i) {
+        trigram = ((trigram << 8) | foldByte(bytes[i])) & 0xFFFFFF;
+        if (i < 2) continue;
+
+        uint64_t& word = seen_[trigram >> 6];
+        const uint64_t bit = uint64_t(1) << (trigram & 63);
+        if (!(word & bit)) {
+            word |= bit;
+            trigrams_.push_back(trigram);
+        }
+    }
+
+    // Маска очищается только по установленным битам, а не целиком
+    for (uint32_t value : trigrams_) {
+        seen_[value >> 6] = 0;
+    }
+    std::sort(trigrams_.begin(), trigrams_.end());
+    return trigrams_;
+}
+
+void ContentIndex::Builder::add(std::string_view path, const WalkEntry& entry, State state,
+                                const std::vector<uint32_t>& trigrams) {
+    const auto id = static_cast<uint32_t>(files_.size());
+    files_.push_back(FileEntry{blob_.size(), static_cast<uint32_t>(path.size()),
+                               static_cast<uint32_t>(state), entry.size, entry.mtime_ns});
+    blob_ += path;
+
+    for (uint32_t trigram : trigrams) {
+        Postings& list = postings_[trigram];
+        appendVarint(list.bytes, list.count == 0 ? id : id - list.last);
+        list.last = id;
+        ++list.count;
+    }
+}
+
+bool ContentIndex::Builder::write(const fs::path& file) const {
+    std::vector<uint32_t> sorted;
+    sorted.reserve(postings_.size());
+    for (const auto& [trigram, list] : postings_) {
+        sorted.push_back(trigram);
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    std::vector<TrigramEntry> table;
+    table.reserve(sorted.size());
+    uint64_t postings_size = 0;
+    for (uint32_t trigram : sorted) {
+        const Postings& list = postings_.at(trigram);
+        table.push_back(TrigramEntry{trigram, list.count, postings_size});
+        postings_size += list.bytes.size();
+    }
+
+    AtomicFile out(file);
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.file_count = files_.size();
+    header.trigram_count = table.size();
+    header.postings_size = postings_size;
+    header.blob_size = blob_.size();
+    out.writeValue(header);
+    out.write(files_.data(), files_.size() * sizeof(FileEntry));
+    out.write(table.data(), table.size() * sizeof(TrigramEntry));
+    for (uint32_t trigram : sorted) {
+        const std::string& bytes = postings_.at(trigram).bytes;
+        out.write(bytes.data(), bytes.size());
+    }
+    static const char kPadding[8] = {};
+    out.write(kPadding, padTo8(postings_size) - postings_size);
+    out.write(blob_.data(), blob_.size());
+    return out.commit();
+}
+
+ContentIndex::ContentIndex(const fs::path& file) {
+    const char* data = nullptr;
+    size_t size = 0;
+
+#if defined(SEEKFS_HAVE_MMAP)
+    const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open content index: " + file.string());
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* mapping = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping != MAP_FAILED) {
+            mapping_ = mapping;
+            mapping_size_ = static_cast<size_t>(st.st_size);
+            data = static_cast<const char*>(mapping);
+            size = mapping_size_;
+        }
+    }
+    ::close(fd);
+#else
+    std::ifstream in(file, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open content index: " + file.string());
+    }
+    buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    data = buffer_.data();
+    size = buffer_.size();
+#endif
+
+    Header header{};
+    if (size >= sizeof(Header)) {
+        std::memcpy(&header, data, sizeof(header));
+    }
+    const uint64_t expected = sizeof(Header) + header.file_count * sizeof(FileEntry) +
+                              header.trigram_count * sizeof(TrigramEntry) +
+                              padTo8(header.postings_size) + header.blob_size;
+    if (size < sizeof(Header) || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || expected != size) {
+        throw std::runtime_error("Invalid content index: " + file.string());
+    }
+
+    const char* pos = data + sizeof(Header);
+    files_ = reinterpret_cast<const FileEntry*>(pos);
+    pos += header.file_count * sizeof(FileEntry);
+    trigrams_ = reinterpret_cast<const TrigramEntry*>(pos);
+    pos += header.trigram_count * sizeof(TrigramEntry);
+    postings_ = reinterpret_cast<const unsigned char*>(pos);
+    pos += padTo8(header.postings_size);
+    blob_ = pos;
+    file_count_ = static_cast<size_t>(header.file_count);
+    trigram_count_ = static_cast<size_t>(header.trigram_count);
+    postings_size_ = static_cast<size_t>(header.postings_size);
+}
+
+ContentIndex::~ContentIndex() {
+#if defined(SEEKFS_HAVE_MMAP)
+    if (mapping_) {
+        ::munmap(mapping_, mapping_size_);
+    }
+#endif
+}
+
+std::string_view ContentIndex::path(uint32_t id) const {
+    return std::string_view(blob_ + files_[id].path_offset, files_[id].path_length);
+}
+
+ContentIndex::State ContentIndex::state(uint32_t id) const {
+    return static_cast<State>(files_[id].state);
+}
+
+bool ContentIndex::fresh(uint32_t id, const WalkEntry& entry) const {
+    return files_[id].size == entry.size && files_[id].mtime_ns == entry.mtime_ns;
+}
+
+uint32_t ContentIndex::find(std::string_view path) const {
+    size_t low = 0;
+    size_t high = file_count_;
+    while (low < high) {
+        const size_t mid = low + (high - low) / 2;
+        if (this->path(static_cast<uint32_t>(mid)) < path) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low < file_count_ && this->path(static_cast<uint32_t>(low)) == path
+        ? static_cast<uint32_t>(low) : kNotFound;
+}
+
+const ContentIndex::TrigramEntry* ContentIndex::findTrigram(uint32_t trigram) const {
+    const TrigramEntry* end = trigrams_ + trigram_count_;
+    const TrigramEntry* it = std::lower_bound(trigrams_, end, trigram,
+        [](const TrigramEntry& entry, uint32_t value) { return entry.trigram < value; });
+    return it != end && it->trigram == trigram ? it : nullptr;
+}
+
+std::vector<uint32_t> ContentIndex::decode(const TrigramEntry& entry) const {
+    std::vector<uint32_t> ids;
+    ids.reserve(entry.count);
+
+    const unsigned char* pos = postings_ + entry.offset;
+    const unsigned char* end = postings_ + postings_size_;
+    uint32_t id = 0;
+    for (uint32_t i = 0; i < entry.count && pos < end; ++i) {
+        uint32_t value = 0;
+        unsigned shift = 0;
+        while (pos < end) {
+            const unsigned char byte = *pos++;
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) break;
+            shift += 7;
+        }
+        id = i == 0 ? value : id + value;
+        ids.push_back(id);
+    }
+    return ids;
+}
+
+std::vector<uint32_t> ContentIndex::candidates(const std::vector<std::string>& literals) const {
+    TrigramCollector collector;
+    std::vector<uint32_t> all;
+    for (const auto& literal : literals) {
+        const auto& trigrams = collector.collect(literal.data(), literal.size());
+        all.insert(all.end(), trigrams.begin(), trigrams.end());
+    }
+    std::sort(all.begin(), all.end());
+    all.erase(std::unique(all.begin(), all.end()), all.end());
+
+    if (all.empty()) {
+        std::vector<uint32_t> ids;
+        for (size_t i = 0; i < file_count_; ++i) {
+            if (files_[i].state == static_cast<uint32_t>(State::Indexed)) {
+                ids.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        return ids;
+    }
+
+    std::vector<const TrigramEntry*> lists;
+    for (uint32_t trigram : all) {
+        const TrigramEntry* entry = findTrigram(trigram);
+        if (!entry) {
+            return {};
+        }
+        lists.push_back(entry);
+    }
+
+    // Пересечение начинается с самого короткого списка
+    std::sort(lists.begin(), lists.end(), [](const TrigramEntry* a, const TrigramEntry* b) {
+        return a->count < b->count;
+    });
+
+    std::vector<uint32_t> result = decode(*lists[0]);
+    std::vector<uint32_t> next;
+    for (size_t i = 1; i < lists.size() && !result.empty(); ++i) {
+        const auto ids = decode(*lists[i]);
+        next.clear();
+        std::set_intersection(result.begin(), result.end(), ids.begin(), ids.end(),
+                              std::back_inserter(next));
+        result.swap(next);
+    }
+    return result;
+}
@@ -0,0 +1,112 @@
+//
+//  ContentIndex.h
+//  SeekFS
+//
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+#include <cstdint>
+#include <cstddef>
+#include "DirectoryWalker.h"
+
+namespace fs = std::filesystem;
+
+// Индекс содержимого на диске: для каждого файла запоминаются размер и
+// mtime, для каждой триграммы содержимого (без учёта регистра ASCII) -
+// список файлов, сжатый как разности id в varint. Запрос пересекает
+// списки триграмм шаблона, и читать приходится только оставшиеся файлы.
+class ContentIndex {
+    struct FileEntry {
+        uint64_t path_offset;
+        uint32_t path_length;
+        uint32_t state;
+        uint64_t size;
+        uint64_t mtime_ns;
+    };
+
+    struct TrigramEntry {
+        uint32_t trigram;
+        uint32_t count;
+        uint64_t offset;       // начало списка в postings
+    };
+
+public:
+    static constexpr uint32_t kNotFound = UINT32_MAX;
+
+    enum class State {
+        Indexed,    // триграммы есть в индексе
+        Binary,     // двоичный файл, триграммы не собирались
+        Unindexed   // не удалось прочитать при построении
+    };
+
+    // Триграммы файла: без повторов, по возрастанию
+    class TrigramCollector {
+    public:
+        TrigramCollector();
+        const std::vector<uint32_t>& collect(const char* data, size_t size);
+
+    private:
+        std::vector<uint64_t> seen_;   // битовая маска на все 2^24 триграмм
+        std::vector<uint32_t> trigrams_;
+    };
+
+    // Собирает индекс в памяти: списки сразу хранятся сжатыми. Файлы
+    // добавляются по возрастанию path, id - порядковый номер add; path -
+    // ключ для find, размер и mtime берутся из entry
+    class Builder {
+    public:
+        void add(std::string_view path, const WalkEntry& entry, State state,
+                 const std::vector<uint32_t>& trigrams);
+        // Через AtomicFile; false - не удалось записать
+        bool write(const fs::path& file) const;
+
+    private:
+        struct Postings {
+            std::string bytes;
+            uint32_t last = 0;
+            uint32_t count = 0;
+        };
+
+        std::vector<FileEntry> files_;
+        std::string blob_;
+        std::unordered_map<uint32_t, Postings> postings_;
+    };
+
+    // Бросает std::runtime_error, если индекс не открывается или повреждён
+    explicit ContentIndex(const fs::path& file);
+    ~ContentIndex();
+
+    ContentIndex(const ContentIndex&) = delete;
+    ContentIndex& operator=(const ContentIndex&) = delete;
+
+    size_t size() const { return file_count_; }
+    std::string_view path(uint32_t id) const;
+    State state(uint32_t id) const;
+    // Размер и mtime совпадают с записанными при построении
+    bool fresh(uint32_t id, const WalkEntry& entry) const;
+    // Двоичный поиск по пути; kNotFound - файла нет в индексе
+    uint32_t find(std::string_view path) const;
+
+    // Проиндексированные файлы, содержащие все триграммы литералов, по
+    // возрастанию id. Без триграмм - все проиндексированные файлы
+    std::vector<uint32_t> candidates(const std::vector<std::string>& literals) const;
+
+private:
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    std::vector<char> buffer_; // без mmap файл читается сюда
+
+    const FileEntry* files_ = nullptr;
+    const TrigramEntry* trigrams_ = nullptr;
+    const unsigned char* postings_ = nullptr;
+    const char* blob_ = nullptr;
+    size_t file_count_ = 0;
+    size_t trigram_count_ = 0;
+    size_t postings_size_ = 0;
+
+    const TrigramEntry* findTrigram(uint32_t trigram) const;
+    std::vector<uint32_t> decode(const TrigramEntry& entry) const;
+};
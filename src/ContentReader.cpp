@@ -0,0 +1,158 @@
+//
+//  ContentReader.cpp
+//  SeekFS
+//
+#include "ContentReader.h"
+#include <fstream>
+#include <new>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SEEKFS_HAVE_MMAP 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+    constexpr size_t kBufferAlignment = 64;
+
+    struct ThreadBuffer {
+        char* data = nullptr;
+        size_t capacity = 0;
+
+        ~ThreadBuffer() { release(); }
+
+        char* reserve(size_t size) {
+            if (size <= capacity) return data;
+            release();
+            size_t new_capacity = capacity ? capacity : 64 * 1024;
+            while (new_capacity < size) new_capacity *= 2;
+            data = static_cast<char*>(::operator new(new_capacity, std::align_val_t(kBufferAlignment)));
+            capacity = new_capacity;
+            return data;
+        }
+
+        void release() {
+            if (data) ::operator delete(data, std::align_val_t(kBufferAlignment));
+            data = nullptr;
+            capacity = 0;
+        }
+    };
+
+    thread_local ThreadBuffer thread_buffer;
+}
+
+#if defined(SEEKFS_HAVE_MMAP)
+ContentReader::ContentReader(const fs::path& path, uintmax_t max_size) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || static_cast<uintmax_t>(st.st_size) > max_size) {
+        ::close(fd);
+        return;
+    }
+
+    const size_t size = static_cast<size_t>(st.st_size);
+    if (size >= kMmapThreshold) {
+        void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            ::madvise(mapping, size, MADV_SEQUENTIAL);
+            mapping_ = mapping;
+            data_ = static_cast<const char*>(mapping);
+            size_ = size;
+            ok_ = true;
+            ::close(fd);
+            return;
+        }
+    }
+
+    char* buffer = thread_buffer.reserve(size);
+    size_t total = 0;
+    while (total < size) {
+        const ssize_t n = ::read(fd, buffer + total, size - total);
+        if (n < 0) {
+            ::close(fd);
+            return;
+        }
+        if (n == 0) break;
+        total += static_cast<size_t>(n);
+    }
+    ::close(fd);
+
+    data_ = buffer;
+    size_ = total;
+    ok_ = true;
+}
+
+ContentReader::~ContentReader() {
+    if (mapping_) {
+        ::munmap(mapping_, size_);
+    }
+}
+#else
+ContentReader::ContentReader(const fs::path& path, uintmax_t max_size) {
+    std::error_code ec;
+    const auto size = fs::file_size(path, ec);
+    if (ec || size > max_size) {
+        return;
+    }
+    ok_ = readIntoBuffer(path, static_cast<size_t>(size));
+}
+
+ContentReader::~ContentReader() = default;
+#endif
+
+bool ContentReader::readIntoBuffer(const fs::path& path, size_t size) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) {
+        return false;
+    }
+
+    char* buffer = thread_buffer.reserve(size);
+    stream.read(buffer, static_cast<std::streamsize>(size));
+    if (stream.bad()) {
+        return false;
+    }
+
+    data_ = buffer;
+    size_ = static_cast<size_t>(stream.gcount());
+    return true;
+}
+
+bool ContentReader::looksBinary(const char* data, size_t size) {
+    if (std::memchr(data, '\0', size)) {
+        return true;
+    }
+
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    size_t invalid = 0;
+    size_t i = 0;
+    while (i < size) {
+        const unsigned char c = bytes[i];
+        size_t length = 0;
+        if (c < 0x80) length = 1;
+        else if ((c & 0xE0) == 0xC0 && c >= 0xC2) length = 2;
+        else if ((c & 0xF0) == 0xE0) length = 3;
+        else if ((c & 0xF8) == 0xF0 && c <= 0xF4) length = 4;
+
+        bool valid = length > 0;
+        // Последовательность, обрезанная концом блока, не считается ошибкой
+        for (size_t k = 1; valid && k < length && i + k < size; ++k) {
+            valid = (bytes[i + k] & 0xC0) == 0x80;
+        }
+
+        if (valid) {
+            i += length;
+        } else {
+            ++invalid;
+            ++i;
+        }
+    }
+
+    return invalid * 10 > size * 3;
+}
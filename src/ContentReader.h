@@ -0,0 +1,45 @@
+//
+//  ContentReader.h
+//  SeekFS
+//
+#pragma once
+#include <filesystem>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+namespace fs = std::filesystem;
+
+// Содержимое файла как непрерывный диапазон байт без построчного копирования.
+// Крупные файлы отображаются в память, мелкие читаются в буфер потока,
+// который переиспользуется между файлами. Поэтому в одном потоке
+// одновременно может быть открыт только один ContentReader.
+class ContentReader {
+public:
+    static constexpr size_t kMmapThreshold = 256 * 1024;
+    static constexpr size_t kSniffSize = 8 * 1024;
+
+    // Эвристика по первому блоку: NUL-байт или более 30% невалидного UTF-8
+    static bool looksBinary(const char* data, size_t size);
+
+    // Файл крупнее max_size не читается, ok() остаётся false
+    explicit ContentReader(const fs::path& path, uintmax_t max_size = UINTMAX_MAX);
+    ~ContentReader();
+
+    ContentReader(const ContentReader&) = delete;
+    ContentReader& operator=(const ContentReader&) = delete;
+
+    bool ok() const { return ok_; }
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    std::string_view view() const { return {data_, size_}; }
+    bool isBinary() const { return looksBinary(data_, size_ < kSniffSize ? size_ : kSniffSize); }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    void* mapping_ = nullptr;
+    bool ok_ = false;
+
+    bool readIntoBuffer(const fs::path& path, size_t size);
+};
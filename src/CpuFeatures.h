@@ -0,0 +1,23 @@
+//
+//  CpuFeatures.h
+//  SeekFS
+//
+#pragma once
+
+// AVX2-варианты собираются через target-атрибуты и выбираются при запуске,
+// поэтому бинарник остается совместимым с процессорами без AVX2
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SEEKFS_AVX2_DISPATCH 1
+#define SEEKFS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace CpuFeatures {
+    inline bool hasAVX2() {
+#if defined(SEEKFS_AVX2_DISPATCH)
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+#else
+        return false;
+#endif
+    }
+}
@@ -0,0 +1,175 @@
+//
+//  DirectorySnapshot.cpp
+//  SeekFS
+//
+#include "DirectorySnapshot.h"
+#include "AtomicFile.h"
+#include <fstream>
+#include <iterator>
+#include <chrono>
+#include <cstring>
+
+namespace {
+    constexpr char kMagic[8] = {'S', 'K', 'F', 'S', 'D', 'S', '0', '2'};
+
+    struct Header {
+        char magic[8];
+        uint64_t dir_count;
+    };
+
+    struct DirRecord {
+        uint64_t device;
+        uint64_t inode;
+        uint64_t mtime_ns;
+        uint64_t ctime_ns;
+        uint32_t child_count;
+        uint32_t reserved;
+    };
+
+    struct ChildRecord {
+        uint8_t type;
+        uint8_t reserved;
+        uint16_t name_length;
+    };
+
+    uint64_t nowNs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
+    class Cursor {
+    public:
+        Cursor(const char* data, size_t size) : pos_(data), end_(data + size) {}
+
+        template<typename T>
+        bool read(T& value) {
+            if (static_cast<size_t>(end_ - pos_) < sizeof(T)) return false;
+            std::memcpy(&value, pos_, sizeof(T));
+            pos_ += sizeof(T);
+            return true;
+        }
+
+        bool read(size_t length, std::string_view& bytes) {
+            if (static_cast<size_t>(end_ - pos_) < length) return false;
+            bytes = std::string_view(pos_, length);
+            pos_ += length;
+            return true;
+        }
+
+    private:
+        const char* pos_;
+        const char* end_;
+    };
+}
+
+void DirectorySnapshot::Listing::add(std::string_view name, ChildType type) {
+    children.push_back(Child{static_cast<uint32_t>(names.size()), static_cast<uint16_t>(name.size()), type});
+    names.append(name);
+}
+
+DirectorySnapshot::DirectorySnapshot(fs::path file, std::chrono::nanoseconds racy_window)
+    : file_(std::move(file)), racy_window_ns_(static_cast<uint64_t>(racy_window.count())) {
+    load();
+}
+
+void DirectorySnapshot::load() {
+    std::ifstream in(file_, std::ios::binary);
+    if (!in) {
+        return;
+    }
+    const std::vector<char> buffer((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    Cursor cursor(buffer.data(), buffer.size());
+    Header header;
+    if (!cursor.read(header) || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        return;
+    }
+
+    std::unordered_map<DirKey, Listing, DirKeyHash> loaded;
+    for (uint64_t i = 0; i < header.dir_count; ++i) {
+        DirRecord record;
+        if (!cursor.read(record)) {
+            return;
+        }
+
+        Listing listing;
+        listing.stamp = Stamp{record.device, record.inode, record.mtime_ns, record.ctime_ns};
+        listing.children.reserve(record.child_count);
+        for (uint32_t j = 0; j < record.child_count; ++j) {
+            ChildRecord child;
+            std::string_view name;
+            if (!cursor.read(child) || !cursor.read(child.name_length, name) ||
+                child.type > static_cast<uint8_t>(ChildType::Link)) {
+                return;
+            }
+            listing.add(name, static_cast<ChildType>(child.type));
+        }
+        loaded.emplace(keyOf(listing.stamp), std::move(listing));
+    }
+    loaded_ = std::move(loaded);
+}
+
+const DirectorySnapshot::Listing* DirectorySnapshot::find(const Stamp& stamp) {
+    auto it = loaded_.find(keyOf(stamp));
+    if (it == loaded_.end() || !(it->second.stamp == stamp)) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    kept_[it->first] = &it->second;
+    ++reused_;
+    return &it->second;
+}
+
+void DirectorySnapshot::record(Listing listing) {
+    const uint64_t racy_after = nowNs() - racy_window_ns_;
+    if (listing.stamp.mtime_ns >= racy_after || listing.stamp.ctime_ns >= racy_after) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const DirKey key = keyOf(listing.stamp);
+    current_[key] = std::move(listing);
+}
+
+bool DirectorySnapshot::save(bool prune) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<const Listing*> dirs;
+    dirs.reserve(kept_.size() + current_.size());
+    for (const auto& [key, listing] : current_) {
+        dirs.push_back(&listing);
+    }
+    for (const auto& [key, listing] : kept_) {
+        if (current_.find(key) == current_.end()) {
+            dirs.push_back(listing);
+        }
+    }
+    if (!prune) {
+        for (const auto& [key, listing] : loaded_) {
+            if (current_.find(key) == current_.end() && kept_.find(key) == kept_.end()) {
+                dirs.push_back(&listing);
+            }
+        }
+    }
+
+    AtomicFile out(file_);
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.dir_count = dirs.size();
+    out.writeValue(header);
+
+    for (const Listing* listing : dirs) {
+        const DirRecord record{listing->stamp.device, listing->stamp.inode,
+                               listing->stamp.mtime_ns, listing->stamp.ctime_ns,
+                               static_cast<uint32_t>(listing->children.size()), 0};
+        out.writeValue(record);
+        for (const auto& child : listing->children) {
+            const ChildRecord child_record{static_cast<uint8_t>(child.type), 0, child.length};
+            out.writeValue(child_record);
+            const std::string_view name = listing->name(child);
+            out.write(name.data(), name.size());
+        }
+    }
+    return out.commit();
+}
@@ -0,0 +1,105 @@
+//
+//  DirectorySnapshot.h
+//  SeekFS
+//
+#pragma once
+#include <string>
+#include <string_view>
+#include <functional>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+namespace fs = std::filesystem;
+
+// Списки содержимого директорий с прошлого обхода. Пока у директории
+// не изменились inode, mtime и ctime, её набор имён тот же, и вместо
+// readdir обход берёт список отсюда. Директория узнаётся по (st_dev, st_ino),
+// а не по пути, поэтому `./x`, `x` и `/abs/x` делят одну запись. Размеры
+// и время изменения файлов здесь не хранятся: их по-прежнему даёт stat
+// самого файла.
+class DirectorySnapshot {
+public:
+    enum class ChildType : uint8_t {
+        File,
+        Directory,
+        Link        // цель проверяется заново при каждом обходе
+    };
+
+    struct Stamp {
+        uint64_t device = 0;
+        uint64_t inode = 0;
+        uint64_t mtime_ns = 0;
+        uint64_t ctime_ns = 0;
+        bool operator==(const Stamp& other) const {
+            return device == other.device && inode == other.inode &&
+                   mtime_ns == other.mtime_ns && ctime_ns == other.ctime_ns;
+        }
+    };
+
+    struct Listing {
+        struct Child {
+            uint32_t offset;   // начало имени в names
+            uint16_t length;
+            ChildType type;
+        };
+
+        Stamp stamp;
+        std::string names;
+        std::vector<Child> children;
+
+        void add(std::string_view name, ChildType type);
+        std::string_view name(const Child& child) const { return {names.data() + child.offset, child.length}; }
+    };
+
+    // Чужой или повреждённый файл игнорируется и будет перезаписан.
+    // Директории, изменённые позже racy_window назад, не запоминаются:
+    // следующее изменение в тот же тик часов не сдвинуло бы их mtime
+    explicit DirectorySnapshot(fs::path file,
+                               std::chrono::nanoseconds racy_window = std::chrono::seconds(2));
+
+    DirectorySnapshot(const DirectorySnapshot&) = delete;
+    DirectorySnapshot& operator=(const DirectorySnapshot&) = delete;
+
+    // Потокобезопасны. find возвращает список прошлого обхода, если
+    // метка директории совпала; указатель живёт столько же, сколько объект
+    const Listing* find(const Stamp& stamp);
+    void record(Listing listing);
+
+    // Записывает директории, увиденные в этом обходе. С prune = false
+    // сохраняются и не увиденные (обход был прерван); false - не удалось записать
+    bool save(bool prune = true);
+
+    size_t reusedCount() const { return reused_; }
+    size_t rescannedCount() const { return current_.size(); }
+
+private:
+    struct DirKey {
+        uint64_t device;
+        uint64_t inode;
+        bool operator==(const DirKey& other) const { return device == other.device && inode == other.inode; }
+    };
+
+    struct DirKeyHash {
+        size_t operator()(const DirKey& key) const {
+            return std::hash<uint64_t>()(key.inode ^ (key.device * 0x9e3779b97f4a7c15ull));
+        }
+    };
+
+    static DirKey keyOf(const Stamp& stamp) { return DirKey{stamp.device, stamp.inode}; }
+
+    fs::path file_;
+    uint64_t racy_window_ns_;
+    std::unordered_map<DirKey, Listing, DirKeyHash> loaded_;
+
+    std::mutex mutex_;
+    std::unordered_map<DirKey, const Listing*, DirKeyHash> kept_;
+    std::unordered_map<DirKey, Listing, DirKeyHash> current_;
+    size_t reused_ = 0;
+
+    void load();
+};
@@ -0,0 +1,427 @@
+//
+//  DirectoryWalker.cpp
+//  SeekFS
+//
+#include "DirectoryWalker.h"
+#include <algorithm>
+#include <thread>
+#include <chrono>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SEEKFS_HAVE_STAT 1
+#include <sys/stat.h>
+
+namespace {
+    uint64_t modificationTimeNs(const struct stat& st) {
+#if defined(__APPLE__)
+        const auto& mtime = st.st_mtimespec;
+#else
+        const auto& mtime = st.st_mtim;
+#endif
+        return static_cast<uint64_t>(mtime.tv_sec) * 1000000000ull + static_cast<uint64_t>(mtime.tv_nsec);
+    }
+
+    uint64_t changeTimeNs(const struct stat& st) {
+#if defined(__APPLE__)
+        const auto& ctime = st.st_ctimespec;
+#else
+        const auto& ctime = st.st_ctim;
+#endif
+        return static_cast<uint64_t>(ctime.tv_sec) * 1000000000ull + static_cast<uint64_t>(ctime.tv_nsec);
+    }
+
+    DirectorySnapshot::Stamp directoryStamp(const struct stat& st) {
+        return DirectorySnapshot::Stamp{static_cast<uint64_t>(st.st_dev), static_cast<uint64_t>(st.st_ino),
+                                        modificationTimeNs(st), changeTimeNs(st)};
+    }
+}
+#endif
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+namespace {
+    constexpr size_t kDirentBufferSize = 256 * 1024;
+
+    struct LinuxDirent64 {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[];
+    };
+
+    class FdGuard {
+    public:
+        explicit FdGuard(int fd) : fd_(fd) {}
+        ~FdGuard() { if (fd_ >= 0) ::close(fd_); }
+        FdGuard(const FdGuard&) = delete;
+        FdGuard& operator=(const FdGuard&) = delete;
+        int get() const { return fd_; }
+    private:
+        int fd_;
+    };
+}
+#endif
+
+DirectoryWalker::DirectoryWalker(int num_threads)
+    : num_threads_(static_cast<size_t>(std::max(1, num_threads))) {}
+
+bool DirectoryWalker::statFile(WalkEntry& entry) {
+#if defined(SEEKFS_HAVE_STAT)
+    struct stat st;
+    if (::stat(entry.path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    entry.size = static_cast<uintmax_t>(st.st_size);
+    entry.device = static_cast<uint64_t>(st.st_dev);
+    entry.inode = static_cast<uint64_t>(st.st_ino);
+    entry.mtime_ns = modificationTimeNs(st);
+    return true;
+#else
+    std::error_code ec;
+    if (!fs::is_regular_file(entry.path, ec)) {
+        return false;
+    }
+    entry.size = fs::file_size(entry.path, ec);
+    return !ec;
+#endif
+}
+
+void DirectoryWalker::walk(const fs::path& root, const FileSink& sink) {
+    queues_.clear();
+    for (size_t i = 0; i < num_threads_; ++i) {
+        queues_.push_back(std::make_unique<WorkQueue>());
+    }
+    pending_ = 0;
+#if defined(__linux__)
+    dirent_buffers_.assign(num_threads_, std::vector<char>());
+#endif
+    pushDirectory(0, root);
+
+    std::vector<std::thread> workers;
+    workers.reserve(num_threads_ - 1);
+    for (size_t i = 1; i < num_threads_; ++i) {
+        workers.emplace_back(&DirectoryWalker::workerLoop, this, i, std::cref(sink));
+    }
+    workerLoop(0, sink);
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    queues_.clear();
+    dirent_buffers_.clear();
+}
+
+void DirectoryWalker::workerLoop(size_t worker, const FileSink& sink) {
+    size_t idle_rounds = 0;
+    fs::path dir;
+
+    while (!stopped()) {
+        if (popLocal(worker, dir) || steal(worker, dir)) {
+            idle_rounds = 0;
+            scanDirectory(worker, dir, sink);
+            // Счетчик уменьшается только после того, как дочерние директории
+            // уже поставлены в очередь, поэтому ноль означает конец обхода
+            pending_.fetch_sub(1, std::memory_order_acq_rel);
+            continue;
+        }
+
+        if (pending_.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+
+        if (++idle_rounds < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+}
+
+void DirectoryWalker::scanDirectory(size_t worker, const fs::path& dir, const FileSink& sink) {
+    if (directory_sink_) {
+        directory_sink_(worker, dir);
+    }
+#if defined(__linux__)
+    scanDirectoryLinux(worker, dir, sink);
+#else
+    scanDirectoryPortable(worker, dir, sink);
+#endif
+}
+
+#if defined(__linux__)
+// getdents64 отдает записи пачками вместе с d_type, поэтому stat нужен
+// только для файлов, чей размер действительно требуется, и для DT_UNKNOWN.
+// Все stat выполняются относительно дескриптора родительской директории.
+void DirectoryWalker::scanDirectoryLinux(size_t worker, const fs::path& dir, const FileSink& sink) {
+    FdGuard dir_fd(::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (dir_fd.get() < 0) {
+        return;
+    }
+
+    // Со снимком директория стоит одного fstat, пока её метка не изменилась
+    DirectorySnapshot::Listing listing;
+    bool record = false;
+    if (snapshot_) {
+        struct stat dir_st;
+        if (::fstat(dir_fd.get(), &dir_st) == 0) {
+            listing.stamp = directoryStamp(dir_st);
+            if (const auto* cached = snapshot_->find(listing.stamp)) {
+                for (const auto& child : cached->children) {
+                    if (stopped()) {
+                        return;
+                    }
+                    const unsigned char type = child.type == DirectorySnapshot::ChildType::Directory ? DT_DIR
+                                             : child.type == DirectorySnapshot::ChildType::Link ? DT_LNK : DT_REG;
+                    const std::string name(cached->name(child));
+                    emitEntryLinux(worker, dir, dir_fd.get(), name.c_str(), type, nullptr, sink);
+                }
+                return;
+            }
+            record = true;
+        }
+    }
+
+    auto& buffer = dirent_buffers_[worker];
+    if (buffer.empty()) {
+        buffer.resize(kDirentBufferSize);
+    }
+
+    while (true) {
+        const long nread = ::syscall(SYS_getdents64, dir_fd.get(), buffer.data(), buffer.size());
+        if (nread == 0) {
+            break;
+        }
+        // Недочитанная директория в снимок не попадает
+        if (nread < 0 || stopped()) {
+            return;
+        }
+
+        for (long offset = 0; offset < nread;) {
+            const auto* entry = reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset);
+            offset += entry->d_reclen;
+
+            const char* name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+
+            unsigned char type = ignore_dirent_types_ ? static_cast<unsigned char>(DT_UNKNOWN) : entry->d_type;
+            struct stat st;
+            bool have_stat = false;
+
+            if (type == DT_UNKNOWN) {
+                if (::fstatat(dir_fd.get(), name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                    continue;
+                }
+                have_stat = true;
+                if (S_ISDIR(st.st_mode)) type = DT_DIR;
+                else if (S_ISREG(st.st_mode)) type = DT_REG;
+                else if (S_ISLNK(st.st_mode)) type = DT_LNK;
+                else continue;
+            }
+
+            if (type != DT_DIR && type != DT_REG && type != DT_LNK) {
+                continue;
+            }
+            if (record) {
+                listing.add(name, type == DT_DIR ? DirectorySnapshot::ChildType::Directory
+                                : type == DT_LNK ? DirectorySnapshot::ChildType::Link
+                                                 : DirectorySnapshot::ChildType::File);
+            }
+            emitEntryLinux(worker, dir, dir_fd.get(), name, type, have_stat ? &st : nullptr, sink);
+        }
+    }
+
+    if (record) {
+        snapshot_->record(std::move(listing));
+    }
+}
+
+void DirectoryWalker::emitEntryLinux(size_t worker, const fs::path& dir, int dir_fd, const char* name,
+                                     unsigned char type, const struct stat* known, const FileSink& sink) {
+    if (type == DT_DIR) {
+        pushDirectory(worker, dir / name);
+        return;
+    }
+
+    struct stat st;
+    bool have_stat = known != nullptr;
+    if (known) {
+        st = *known;
+    }
+
+    if (type == DT_LNK) {
+        // Ссылки на файлы учитываются как файлы, на директории - пропускаются
+        if (::fstatat(dir_fd, name, &st, 0) != 0 || !S_ISREG(st.st_mode)) {
+            return;
+        }
+        have_stat = true;
+    }
+
+    fs::path path = dir / name;
+    if (filter_ && !filter_(path)) {
+        return;
+    }
+
+    WalkEntry file{std::move(path)};
+    if (sizeRequired()) {
+        if (!have_stat && ::fstatat(dir_fd, name, &st, 0) != 0) {
+            return;
+        }
+        // Из снимка тип мог устареть, если файл подменили директорией того же имени
+        if (!S_ISREG(st.st_mode)) {
+            return;
+        }
+        file.size = static_cast<uintmax_t>(st.st_size);
+        if (file.size > max_file_size_) {
+            return;
+        }
+        file.device = static_cast<uint64_t>(st.st_dev);
+        file.inode = static_cast<uint64_t>(st.st_ino);
+        file.mtime_ns = modificationTimeNs(st);
+    }
+
+    sink(worker, std::move(file));
+}
+#endif
+
+void DirectoryWalker::scanDirectoryPortable(size_t worker, const fs::path& dir, const FileSink& sink) {
+    DirectorySnapshot::Listing listing;
+    bool record = false;
+#if defined(SEEKFS_HAVE_STAT)
+    if (snapshot_) {
+        struct stat dir_st;
+        if (::stat(dir.c_str(), &dir_st) == 0) {
+            listing.stamp = directoryStamp(dir_st);
+            if (const auto* cached = snapshot_->find(listing.stamp)) {
+                for (const auto& child : cached->children) {
+                    if (stopped()) {
+                        return;
+                    }
+                    fs::path path = dir / cached->name(child);
+                    std::error_code ec;
+                    if (child.type == DirectorySnapshot::ChildType::Directory) {
+                        pushDirectory(worker, std::move(path));
+                    } else if (fs::is_regular_file(path, ec)) {
+                        emitFilePortable(worker, std::move(path), sink);
+                    }
+                }
+                return;
+            }
+            record = true;
+        }
+    }
+#endif
+
+    std::error_code ec;
+    fs::directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec);
+    if (ec) {
+        return;
+    }
+
+    for (const fs::directory_iterator end; it != end; it.increment(ec)) {
+        if (ec || stopped()) {
+            return;
+        }
+
+        const auto& entry = *it;
+        std::error_code entry_ec;
+
+        // Как и recursive_directory_iterator, по символическим ссылкам
+        // на директории не переходим
+        const bool is_link = entry.is_symlink(entry_ec);
+        if (entry.is_directory(entry_ec) && !is_link) {
+            if (record) {
+                listing.add(entry.path().filename().string(), DirectorySnapshot::ChildType::Directory);
+            }
+            pushDirectory(worker, entry.path());
+            continue;
+        }
+
+        if (record && (is_link || entry.is_regular_file(entry_ec))) {
+            listing.add(entry.path().filename().string(),
+                        is_link ? DirectorySnapshot::ChildType::Link : DirectorySnapshot::ChildType::File);
+        }
+
+        if (!entry.is_regular_file(entry_ec)) {
+            continue;
+        }
+
+        emitFilePortable(worker, entry.path(), sink);
+    }
+
+    if (record) {
+        snapshot_->record(std::move(listing));
+    }
+}
+
+void DirectoryWalker::emitFilePortable(size_t worker, fs::path path, const FileSink& sink) {
+    if (filter_ && !filter_(path)) {
+        return;
+    }
+
+    WalkEntry file{std::move(path)};
+    if (sizeRequired()) {
+#if defined(SEEKFS_HAVE_STAT)
+        struct stat st;
+        if (::stat(file.path.c_str(), &st) != 0) {
+            return;
+        }
+        file.size = static_cast<uintmax_t>(st.st_size);
+        file.device = static_cast<uint64_t>(st.st_dev);
+        file.inode = static_cast<uint64_t>(st.st_ino);
+        file.mtime_ns = modificationTimeNs(st);
+#else
+        std::error_code ec;
+        file.size = fs::file_size(file.path, ec);
+        if (ec) {
+            return;
+        }
+#endif
+        if (file.size > max_file_size_) {
+            return;
+        }
+    }
+
+    sink(worker, std::move(file));
+}
+
+void DirectoryWalker::pushDirectory(size_t worker, fs::path dir) {
+    pending_.fetch_add(1, std::memory_order_acq_rel);
+    auto& queue = *queues_[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.dirs.push_back(std::move(dir));
+}
+
+bool DirectoryWalker::popLocal(size_t worker, fs::path& dir) {
+    auto& queue = *queues_[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.dirs.empty()) {
+        return false;
+    }
+    // Свою очередь разбираем с конца: обход в глубину бережет кэш dentry
+    dir = std::move(queue.dirs.back());
+    queue.dirs.pop_back();
+    return true;
+}
+
+bool DirectoryWalker::steal(size_t worker, fs::path& dir) {
+    for (size_t offset = 1; offset < num_threads_; ++offset) {
+        auto& victim = *queues_[(worker + offset) % num_threads_];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || victim.dirs.empty()) {
+            continue;
+        }
+        // Чужую очередь забираем с начала: там лежат самые крупные поддеревья
+        dir = std::move(victim.dirs.front());
+        victim.dirs.pop_front();
+        return true;
+    }
+    return false;
+}
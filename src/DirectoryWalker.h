@@ -0,0 +1,104 @@
+//
+//  DirectoryWalker.h
+//  SeekFS
+//
+#pragma once
+#include <vector>
+#include <deque>
+#include <string>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include "DirectorySnapshot.h"
+
+namespace fs = std::filesystem;
+
+#if defined(__linux__)
+struct stat;
+#endif
+
+struct WalkEntry {
+    fs::path path;
+    uintmax_t size = 0;
+    // Идентичность и время изменения файла; заполняются вместе с размером, 0 - неизвестно
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    uint64_t mtime_ns = 0;
+};
+
+// Параллельный обход дерева: каждый поток держит свою очередь директорий,
+// а освободившиеся потоки забирают работу из чужих очередей.
+class DirectoryWalker {
+public:
+    using FileFilter = std::function<bool(const fs::path&)>;
+    using FileSink = std::function<void(size_t worker, WalkEntry&& entry)>;
+    using DirectorySink = std::function<void(size_t worker, const fs::path& dir)>;
+
+    explicit DirectoryWalker(int num_threads = 4);
+
+    void setMaxFileSize(uintmax_t max_size) { max_file_size_ = max_size; }
+    void setFilter(FileFilter filter) { filter_ = std::move(filter); }
+    // Размер (и device/inode/mtime) запрашивается только если он нужен
+    // вызывающему коду или для ограничения max_file_size
+    void setNeedSize(bool need) { need_size_ = need; }
+    // Обход прекращается, как только флаг станет true
+    void setStopFlag(const std::atomic<bool>* stop) { stop_ = stop; }
+
+    // Директории с неизменной меткой берутся из снимка без readdir,
+    // прочитанные заново записываются в него
+    void setSnapshot(DirectorySnapshot* snapshot) { snapshot_ = snapshot; }
+    // Вызывается для каждой директории (и корня) до чтения её содержимого
+    void setDirectorySink(DirectorySink sink) { directory_sink_ = std::move(sink); }
+
+    // Для тестов: d_type из getdents64 не используется, как на файловых
+    // системах, которые всегда возвращают DT_UNKNOWN
+    void ignoreDirentTypes(bool ignore) { ignore_dirent_types_ = ignore; }
+
+    size_t workerCount() const { return num_threads_; }
+
+    // stat одного файла с переходом по ссылкам: заполняет size, device,
+    // inode и mtime_ns; false - не обычный файл или stat не удался
+    static bool statFile(WalkEntry& entry);
+
+    // sink вызывается из рабочих потоков; worker < workerCount()
+    void walk(const fs::path& root, const FileSink& sink);
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<fs::path> dirs;
+    };
+
+    size_t num_threads_;
+    uintmax_t max_file_size_ = UINTMAX_MAX;
+    bool need_size_ = false;
+    bool ignore_dirent_types_ = false;
+    const std::atomic<bool>* stop_ = nullptr;
+    FileFilter filter_;
+    DirectorySink directory_sink_;
+    DirectorySnapshot* snapshot_ = nullptr;
+
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::atomic<size_t> pending_{0};
+    std::vector<std::vector<char>> dirent_buffers_;
+
+    void workerLoop(size_t worker, const FileSink& sink);
+    void scanDirectory(size_t worker, const fs::path& dir, const FileSink& sink);
+    void scanDirectoryPortable(size_t worker, const fs::path& dir, const FileSink& sink);
+    // Обычный файл (или ссылка на него): фильтр, размер и передача в sink
+    void emitFilePortable(size_t worker, fs::path path, const FileSink& sink);
+#if defined(__linux__)
+    void scanDirectoryLinux(size_t worker, const fs::path& dir, const FileSink& sink);
+    // known - результат fstatat без перехода по ссылке, если он уже есть
+    void emitEntryLinux(size_t worker, const fs::path& dir, int dir_fd, const char* name,
+                        unsigned char type, const struct stat* known, const FileSink& sink);
+#endif
+    bool stopped() const { return stop_ && stop_->load(std::memory_order_relaxed); }
+    bool sizeRequired() const { return need_size_ || max_file_size_ != UINTMAX_MAX; }
+    void pushDirectory(size_t worker, fs::path dir);
+    bool popLocal(size_t worker, fs::path& dir);
+    bool steal(size_t worker, fs::path& dir);
+};
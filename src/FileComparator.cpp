@@ -0,0 +1,119 @@
+//
+//  FileComparator.cpp
+//  SeekFS
+//
+#include "FileComparator.h"
+#include <fstream>
+#include <memory>
+#include <cstring>
+
+namespace {
+    struct Candidate {
+        size_t index;
+        std::ifstream stream;
+        std::vector<char> chunk;
+        size_t length = 0;
+    };
+
+    bool sameChunk(const Candidate& a, const Candidate& b) {
+        return a.length == b.length && std::memcmp(a.chunk.data(), b.chunk.data(), a.length) == 0;
+    }
+}
+
+std::vector<std::vector<size_t>> FileComparator::splitIdentical(const std::vector<fs::path>& paths) {
+    std::vector<std::vector<size_t>> result;
+    for (auto& identical : split(paths, nullptr)) {
+        result.push_back(std::move(identical.indices));
+    }
+    return result;
+}
+
+std::vector<FileComparator::Identical> FileComparator::splitIdentical(const std::vector<fs::path>& paths,
+                                                                      const Hasher& hasher) {
+    return split(paths, &hasher);
+}
+
+std::vector<FileComparator::Identical> FileComparator::split(const std::vector<fs::path>& paths,
+                                                             const Hasher* hasher) {
+    struct Group {
+        std::vector<std::unique_ptr<Candidate>> members;
+        std::unique_ptr<Hasher> hasher;
+    };
+
+    std::vector<Group> groups(1);
+    if (hasher) {
+        groups[0].hasher = hasher->clone();
+    }
+    for (size_t i = 0; i < paths.size(); ++i) {
+        auto candidate = std::make_unique<Candidate>();
+        candidate->index = i;
+        candidate->stream.open(paths[i], std::ios::binary);
+        if (candidate->stream.is_open()) {
+            candidate->chunk.resize(kChunkSize);
+            groups[0].members.push_back(std::move(candidate));
+        }
+    }
+
+    std::vector<Identical> result;
+    while (!groups.empty()) {
+        std::vector<Group> next;
+
+        for (auto& group : groups) {
+            if (group.members.size() < 2) {
+                continue;
+            }
+
+            for (auto& candidate : group.members) {
+                candidate->stream.read(candidate->chunk.data(), static_cast<std::streamsize>(kChunkSize));
+                candidate->length = static_cast<size_t>(candidate->stream.gcount());
+            }
+
+            // Делим группу по содержимому куска; обычно она остаётся целой
+            std::vector<Group> parts;
+            for (auto& candidate : group.members) {
+                if (candidate->stream.bad()) {
+                    continue;
+                }
+                auto it = parts.begin();
+                while (it != parts.end() && !sameChunk(*it->members.front(), *candidate)) {
+                    ++it;
+                }
+                if (it == parts.end()) {
+                    parts.emplace_back();
+                    it = parts.end() - 1;
+                }
+                it->members.push_back(std::move(candidate));
+            }
+
+            for (auto& part : parts) {
+                if (part.members.size() < 2) {
+                    continue;
+                }
+                // Префикс до этого куска у всех частей общий: хватает копии состояния
+                if (group.hasher) {
+                    part.hasher = parts.size() == 1 ? std::move(group.hasher) : group.hasher->clone();
+                    const Candidate& front = *part.members.front();
+                    part.hasher->update(reinterpret_cast<const unsigned char*>(front.chunk.data()),
+                                        front.length);
+                }
+                // Неполный кусок - конец файла, и у всей части он одинаковый
+                if (part.members.front()->length < kChunkSize) {
+                    Identical identical;
+                    for (const auto& candidate : part.members) {
+                        identical.indices.push_back(candidate->index);
+                    }
+                    if (part.hasher) {
+                        identical.digest = part.hasher->finalize();
+                    }
+                    result.push_back(std::move(identical));
+                } else {
+                    next.push_back(std::move(part));
+                }
+            }
+        }
+
+        groups = std::move(next);
+    }
+
+    return result;
+}
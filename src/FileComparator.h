@@ -0,0 +1,37 @@
+//
+//  FileComparator.h
+//  SeekFS
+//
+#pragma once
+#include <vector>
+#include <filesystem>
+#include <cstddef>
+#include "Hasher.h"
+
+namespace fs = std::filesystem;
+
+// Побайтовое сравнение файлов одного размера. Файлы читаются кусками
+// одновременно, и группа делится на первом же несовпавшем куске,
+// поэтому разные файлы обычно отсеиваются после одного блока,
+// а совпадение подтверждается без риска коллизии хэша.
+class FileComparator {
+public:
+    static constexpr size_t kChunkSize = 64 * 1024;
+
+    struct Identical {
+        std::vector<size_t> indices;
+        Digest digest;   // хэш общего содержимого, если был передан hasher
+    };
+
+    // Группы из двух и более одинаковых файлов, индексы в paths.
+    // Нечитаемые файлы не попадают ни в одну группу
+    static std::vector<std::vector<size_t>> splitIdentical(const std::vector<fs::path>& paths);
+
+    // То же, но каждый прочитанный кусок группы попутно хэшируется копией
+    // hasher (одной на группу: содержимое у всех файлов группы одно),
+    // так что дайджест не требует второго чтения
+    static std::vector<Identical> splitIdentical(const std::vector<fs::path>& paths, const Hasher& hasher);
+
+private:
+    static std::vector<Identical> split(const std::vector<fs::path>& paths, const Hasher* hasher);
+};
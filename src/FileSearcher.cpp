@@ -6,53 +6,170 @@
 //
 
 #include "FileSearcher.h"
+#include "XXH3.h"
 #include <algorithm>
 #include <iterator>
+#include <cstring>
+
+#if defined(__linux__)
+#define SEEKFS_HAVE_FIEMAP 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+#endif
 
 FileSearcher::FileSearcher(const std::string& root_path, int num_threads, bool show_progress)
-    : root_path_(root_path), num_threads_(std::max(1, num_threads)), show_progress_(show_progress) {
+    : root_path_(root_path), num_threads_(std::max(1, num_threads)), show_progress_(show_progress),
+      pool_(std::make_unique<ThreadPool>(num_threads_)) {
     
     if (!fs::exists(root_path_)) {
         throw std::runtime_error("Path does not exist: " + root_path);
     }
 }
 
-std::vector<fs::path> FileSearcher::collectAllFiles() {
-    std::vector<fs::path> files;
+void FileSearcher::configureWalker(DirectoryWalker& walker,
+                                   const DirectoryWalker::FileFilter& name_filter,
+                                   bool need_size) const {
+    // Без размеров обход не делает stat: лимит для чтения содержимого
+    // проверяет ContentReader по своему fstat
+    if (need_size) {
+        walker.setNeedSize(true);
+        walker.setMaxFileSize(max_file_size_);
+    }
+    // Фильтры по имени проверяются до stat, размер запрашивается только у прошедших
+    walker.setFilter([this, name_filter](const fs::path& file) {
+        return matchesFileType(file) && (!name_filter || name_filter(file));
+    });
+}
+
+void FileSearcher::walkRoot(DirectoryWalker& walker, const DirectoryWalker::FileSink& sink,
+                            const std::atomic<bool>* stop) const {
+    std::unique_ptr<DirectorySnapshot> snapshot;
+    if (!dir_snapshot_file_.empty()) {
+        snapshot = std::make_unique<DirectorySnapshot>(dir_snapshot_file_);
+        walker.setSnapshot(snapshot.get());
+    }
+    walker.setStopFlag(stop);
+    walker.walk(root_path_, sink);
     
+    if (snapshot) {
+        // Прерванный обход видел не все директории, остальные сохраняются как были
+        const bool complete = !stop || !stop->load(std::memory_order_relaxed);
+        if (!snapshot->save(complete)) {
+            std::cerr << "⚠️  Failed to write directory snapshot: " << dir_snapshot_file_.string() << std::endl;
+        }
+        if (show_progress_) {
+            std::cout << "Directories from snapshot: " << snapshot->reusedCount()
+                      << ", re-read: " << snapshot->rescannedCount() << std::endl;
+        }
+    }
+}
+
+std::vector<WalkEntry> FileSearcher::collectEntries(const DirectoryWalker::FileFilter& name_filter,
+                                                   bool need_size) {
     if (show_progress_) {
         GraphicsUtils::printSection("Scanning directory structure...");
     }
     
-    try {
-        size_t count = 0;
-        for (const auto& entry : fs::recursive_directory_iterator(
-            root_path_,
-            fs::directory_options::skip_permission_denied
-        )) {
-            if (entry.is_regular_file() &&
-                entry.file_size() <= max_file_size_ &&
-                matchesFileType(entry.path())) {
-                files.push_back(entry.path());
-                count++;
-                
-                if (show_progress_ && count % 100 == 0) {
-                    std::cout << "\rFound " << count << " files..." << std::flush;
-                }
+    DirectoryWalker walker(num_threads_);
+    configureWalker(walker, name_filter, need_size);
+    
+    std::vector<std::vector<WalkEntry>> per_worker(walker.workerCount());
+    std::atomic<size_t> count{0};
+    std::mutex progress_mutex;
+    
+    walkRoot(walker, [&](size_t worker, WalkEntry&& entry) {
+        per_worker[worker].push_back(std::move(entry));
+        
+        size_t found = ++count;
+        if (show_progress_ && found % 100 == 0) {
+            std::unique_lock<std::mutex> lock(progress_mutex, std::try_to_lock);
+            if (lock.owns_lock()) {
+                std::cout << "\rFound " << found << " files..." << std::flush;
             }
         }
+    });
+    
+    std::vector<WalkEntry> entries;
+    entries.reserve(count);
+    for (auto& worker_entries : per_worker) {
+        std::move(worker_entries.begin(), worker_entries.end(), std::back_inserter(entries));
+    }
+    
+    if (show_progress_) {
+        std::cout << "\rFound " << entries.size() << " files total." << std::endl;
+    }
+    
+    return entries;
+}
+
+PathTable FileSearcher::collectAllFiles(const DirectoryWalker::FileFilter& name_filter) {
+    if (show_progress_) {
+        GraphicsUtils::printSection("Scanning directory structure...");
+    }
+    
+    DirectoryWalker walker(num_threads_);
+    configureWalker(walker, name_filter);
+    
+    // Полный путь живёт только до конца пачки: в таблицу пачки попадают
+    // под общим мьютексом, по одному захвату на kInternBatch файлов
+    PathTable files;
+    std::mutex files_mutex;
+    std::vector<std::vector<fs::path>> batches(walker.workerCount());
+    auto flush = [&](std::vector<fs::path>& batch) {
+        std::lock_guard<std::mutex> lock(files_mutex);
+        for (const auto& path : batch) {
+            files.addFile(path);
+        }
+        batch.clear();
+    };
+    
+    std::atomic<size_t> count{0};
+    std::mutex progress_mutex;
+    
+    walkRoot(walker, [&](size_t worker, WalkEntry&& entry) {
+        auto& batch = batches[worker];
+        batch.push_back(std::move(entry.path));
+        if (batch.size() == kInternBatch) {
+            flush(batch);
+        }
         
-        if (show_progress_) {
-            std::cout << "\rFound " << files.size() << " files total." << std::endl;
+        size_t found = ++count;
+        if (show_progress_ && found % 100 == 0) {
+            std::unique_lock<std::mutex> lock(progress_mutex, std::try_to_lock);
+            if (lock.owns_lock()) {
+                std::cout << "\rFound " << found << " files..." << std::flush;
+            }
         }
-    } catch (const fs::filesystem_error& e) {
-        std::cerr << "Filesystem error: " << e.what() << std::endl;
+    });
+    
+    for (auto& batch : batches) {
+        flush(batch);
+    }
+    files.seal();
+    
+    if (show_progress_) {
+        std::cout << "\rFound " << files.size() << " files total." << std::endl;
     }
     
     return files;
 }
 
-bool FileSearcher::matchesFileType(const fs::path& file) {
+std::vector<std::string> FileSearcher::pathStrings(const PathTable& files, const std::vector<uint32_t>& ids) {
+    std::vector<std::string> results;
+    results.reserve(ids.size());
+    for (uint32_t id : ids) {
+        results.push_back(files.path(id));
+    }
+    // Порядок id зависит от того, в каком порядке потоки обхода сдали
+    // пачки в таблицу, поэтому стабильный от запуска к запуску порядок - по пути
+    std::sort(results.begin(), results.end());
+    return results;
+}
+
+bool FileSearcher::matchesFileType(const fs::path& file) const {
     if (file_types_.empty()) return true;
     
     std::string extension = file.extension().string();
@@ -65,102 +182,946 @@ bool FileSearcher::matchesFileType(const fs::path& file) {
     return std::find(file_types_.begin(), file_types_.end(), extension) != file_types_.end();
 }
 
-std::vector<std::string> FileSearcher::processBatch(
-    const std::vector<fs::path>& batch,
-    const std::function<bool(const fs::path&)>& predicate) {
+template<typename Func>
+std::vector<std::string> FileSearcher::processParallel(const PathTable& files, Func func) {
+    if (files.empty()) {
+        return {};
+    }
     
-    std::vector<std::string> results;
-    for (const auto& file : batch) {
-        if (predicate(file)) {
-            results.push_back(file.string());
+    // Мелкие куски раздаются динамически, поэтому один большой файл
+    // не держит весь пакет на одном потоке
+    const size_t workers = pool_->size();
+    const size_t chunk = std::clamp<size_t>(files.size() / (workers * 16), 1, 64);
+    
+    // Путь собирается в буфер потока; наружу уходят только id совпавших
+    std::vector<std::vector<uint32_t>> matched(workers);
+    std::vector<std::string> paths(workers);
+    pool_->parallelFor(files.size(), chunk, [&](size_t worker, size_t index) {
+        const auto id = static_cast<uint32_t>(index);
+        files.writePath(id, paths[worker]);
+        if (func(paths[worker])) {
+            matched[worker].push_back(id);
         }
+    });
+    
+    std::vector<uint32_t> ids;
+    for (const auto& worker_ids : matched) {
+        ids.insert(ids.end(), worker_ids.begin(), worker_ids.end());
     }
-    return results;
+    return pathStrings(files, ids);
 }
 
 template<typename Func>
-std::vector<std::string> FileSearcher::processParallel(
-    const std::vector<fs::path>& files, Func func) {
+size_t FileSearcher::processStreaming(Func func, const MatchCallback& on_match,
+                                      const DirectoryWalker::FileFilter& name_filter) {
+    BoundedQueue<fs::path> queue(kStreamQueueCapacity);
+    std::mutex output_mutex;
+    std::atomic<size_t> matches{0};
     
-    if (files.empty()) {
-        return {};
+    std::thread producer([this, &queue, &name_filter]() {
+        DirectoryWalker walker(num_threads_);
+        configureWalker(walker, name_filter);
+        walkRoot(walker, [&queue](size_t, WalkEntry&& entry) {
+            queue.push(std::move(entry.path));
+        });
+        queue.close();
+    });
+    
+    try {
+        pool_->run([&](size_t) {
+            fs::path file;
+            while (queue.pop(file)) {
+                if (func(file)) {
+                    matches.fetch_add(1, std::memory_order_relaxed);
+                    std::lock_guard<std::mutex> lock(output_mutex);
+                    on_match(file.string());
+                }
+            }
+        });
+    } catch (...) {
+        queue.close();
+        producer.join();
+        throw;
     }
     
-    size_t batch_size = std::max(size_t(1), files.size() / num_threads_);
-    std::vector<std::vector<fs::path>> batches;
+    producer.join();
+    return matches;
+}
+
+Regex FileSearcher::compileRegex(const std::string& pattern) const {
+    try {
+        return Regex(pattern, case_sensitive_);
+    } catch (const std::regex_error& e) {
+        throw std::runtime_error("Invalid regex pattern: " + std::string(e.what()));
+    }
+}
+
+FileSearcher::ContentPattern FileSearcher::compileContentPattern(const std::string& pattern) const {
+    ContentPattern compiled;
+    compiled.regex = compileRegex(pattern);
     
-    for (size_t i = 0; i < files.size(); i += batch_size) {
-        auto end = std::next(files.begin(),
-                           std::min(i + batch_size, files.size()));
-        batches.emplace_back(files.begin() + i, end);
+    std::string longest;
+    for (auto& literal : extractRequiredLiterals(pattern)) {
+        if (literal.size() > longest.size()) {
+            longest = std::move(literal);
+        }
+    }
+    if (!longest.empty()) {
+        compiled.prefilter = std::make_unique<LiteralFinder>(std::move(longest), case_sensitive_);
     }
+    return compiled;
+}
+
+bool FileSearcher::shouldScan(const ContentReader& content) const {
+    return content.ok() && (binary_mode_ != BinaryMode::Skip || !content.isBinary());
+}
+
+bool FileSearcher::contentMatches(const fs::path& file, const ContentPattern& pattern) const {
+    ContentReader content(file, max_file_size_);
+    if (!shouldScan(content)) return false;
     
-    std::vector<std::future<std::vector<std::string>>> futures;
-    for (const auto& batch : batches) {
-        futures.push_back(std::async(std::launch::async,
-            [this, &func, &batch]() {
-                return processBatch(batch, func);
-            }));
+    return contentMatches(content.data(), content.data() + content.size(), pattern);
+}
+
+bool FileSearcher::contentMatches(const char* begin, const char* end, const ContentPattern& pattern) {
+    bool found = false;
+    forEachMatchingLine(begin, end, pattern, [&found](const char*, const char*) {
+        found = true;
+        return false;
+    });
+    return found;
+}
+
+template<typename Func>
+void FileSearcher::forEachMatchingLine(const char* begin, const char* end,
+                                       const ContentPattern& pattern, Func on_line) {
+    const char* pos = begin;
+    
+    if (pattern.prefilter) {
+        // Регулярка запускается только на строках с найденным литералом
+        while (pos < end) {
+            const char* hit = pattern.prefilter->find(pos, end);
+            if (!hit) return;
+            
+            const char* line_start = hit;
+            while (line_start > pos && line_start[-1] != '\n') {
+                --line_start;
+            }
+            const char* newline = static_cast<const char*>(std::memchr(hit, '\n', end - hit));
+            const char* line_end = newline ? newline : end;
+            
+            if (pattern.regex.search(line_start, line_end) && !on_line(line_start, line_end)) {
+                return;
+            }
+            pos = line_end + 1;
+        }
+        return;
     }
     
-    std::vector<std::string> results;
-    for (auto& future : futures) {
-        auto batch_results = future.get();
-        results.insert(results.end(),
-                      batch_results.begin(), batch_results.end());
+    // Регулярное выражение применяется к каждой строке прямо в буфере файла
+    while (pos < end) {
+        const char* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+        const char* line_end = newline ? newline : end;
+        
+        if (pattern.regex.search(pos, line_end) && !on_line(pos, line_end)) {
+            return;
+        }
+        pos = line_end + 1;
     }
+}
+
+size_t FileSearcher::reportMatches(const std::string& pattern, const LineMatchCallback& on_match) {
+    auto compiled = compileContentPattern(pattern);
     
-    return results;
+    BoundedQueue<fs::path> queue(kStreamQueueCapacity);
+    std::atomic<bool> stop{false};
+    std::mutex output_mutex;
+    size_t reported = 0;
+    
+    std::thread producer([this, &queue, &stop]() {
+        DirectoryWalker walker(num_threads_);
+        configureWalker(walker);
+        walkRoot(walker, [&queue](size_t, WalkEntry&& entry) {
+            queue.push(std::move(entry.path));
+        }, &stop);
+        queue.close();
+    });
+    
+    auto cancel = [&]() {
+        stop.store(true, std::memory_order_relaxed);
+        queue.close();
+    };
+    
+    try {
+        pool_->run([&](size_t) {
+            fs::path file;
+            while (!stop.load(std::memory_order_relaxed) && queue.pop(file)) {
+                ContentReader content(file, max_file_size_);
+                if (!shouldScan(content)) continue;
+                
+                const char* begin = content.data();
+                const std::string path = file.string();
+                
+                if (binary_mode_ == BinaryMode::MatchOnly && content.isBinary()) {
+                    if (!contentMatches(begin, begin + content.size(), compiled)) continue;
+                    
+                    std::lock_guard<std::mutex> lock(output_mutex);
+                    if (stop.load(std::memory_order_relaxed)) break;
+                    on_match(ContentMatch{path, 0, 0, std::string(), true});
+                    if (++reported == max_results_) cancel();
+                    continue;
+                }
+                const char* counted = begin;
+                size_t line_number = 1;
+                size_t file_matches = 0;
+                
+                forEachMatchingLine(begin, begin + content.size(), compiled,
+                    [&](const char* line_begin, const char* line_end) {
+                        // Номера строк считаются лениво, только до найденных строк
+                        line_number += std::count(counted, line_begin, '\n');
+                        counted = line_begin;
+                        
+                        ContentMatch match{path, line_number,
+                                           static_cast<size_t>(line_begin - begin),
+                                           std::string(line_begin, line_end)};
+                        {
+                            std::lock_guard<std::mutex> lock(output_mutex);
+                            if (stop.load(std::memory_order_relaxed)) return false;
+                            on_match(match);
+                            if (++reported == max_results_) {
+                                cancel();
+                                return false;
+                            }
+                        }
+                        return !max_count_ || ++file_matches < max_count_;
+                    });
+            }
+        });
+    } catch (...) {
+        cancel();
+        producer.join();
+        throw;
+    }
+    
+    producer.join();
+    return reported;
 }
 
 std::vector<std::string> FileSearcher::searchByName(const std::string& pattern) {
+    auto re = compileRegex(pattern);
+    
+    // Имя проверяется прямо в потоках обхода, до stat
+    auto files = collectAllFiles([&re](const fs::path& file) {
+        return re.search(file.filename().string());
+    });
+    
+    std::vector<uint32_t> ids(files.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        ids[i] = static_cast<uint32_t>(i);
+    }
+    return pathStrings(files, ids);
+}
+
+size_t FileSearcher::buildNameIndex(const fs::path& index_file) {
     auto files = collectAllFiles();
+    if (!NameIndex::build(files, index_file)) {
+        throw std::runtime_error("Cannot write name index: " + index_file.string());
+    }
+    return files.size();
+}
+
+std::vector<std::string> FileSearcher::searchByNameIndexed(const std::string& pattern,
+                                                           const fs::path& index_file) {
+    auto re = compileRegex(pattern);
+    NameIndex index(index_file);
     
-    std::regex re;
-    try {
-        auto flags = case_sensitive_ ? std::regex_constants::ECMAScript
-                                     : std::regex_constants::icase;
-        re = std::regex(pattern, flags);
-    } catch (const std::regex_error& e) {
-        throw std::runtime_error("Invalid regex pattern: " + std::string(e.what()));
+    // Триграммы в индексе без учёта регистра, так что литералы годятся
+    // для отбора при любом case_sensitive_; окончательно решает регулярка
+    auto candidates = index.candidates(extractRequiredLiterals(pattern));
+    if (candidates.empty()) {
+        return {};
+    }
+    
+    const size_t workers = pool_->size();
+    const size_t chunk = std::clamp<size_t>(candidates.size() / (workers * 16), 1, 1024);
+    std::vector<std::vector<uint32_t>> matched(workers);
+    pool_->parallelFor(candidates.size(), chunk, [&](size_t worker, size_t index_pos) {
+        const uint32_t id = candidates[index_pos];
+        const std::string_view name = index.name(id);
+        if (re.search(name.data(), name.data() + name.size()) &&
+            matchesFileType(fs::path(index.path(id)))) {
+            matched[worker].push_back(id);
+        }
+    });
+    
+    std::vector<uint32_t> ids;
+    for (const auto& worker_ids : matched) {
+        ids.insert(ids.end(), worker_ids.begin(), worker_ids.end());
+    }
+    
+    // Как и без индекса, результат упорядочен по пути
+    std::vector<std::string> results;
+    results.reserve(ids.size());
+    for (uint32_t id : ids) {
+        results.emplace_back(index.path(id));
     }
+    std::sort(results.begin(), results.end());
+    return results;
+}
+
+void FileSearcher::watch(const fs::path& index_file, std::chrono::milliseconds interval,
+                         const std::atomic<bool>& stop) {
+    WatchDaemon daemon(root_path_, num_threads_);
+    daemon.setFilter([this](const fs::path& file) { return matchesFileType(file); });
+    daemon.setMaxFileSize(max_file_size_);
     
-    return processParallel(files, [&re](const fs::path& file) {
-        return std::regex_search(file.filename().string(), re);
+    daemon.run(stop, interval, [&](const std::vector<WalkEntry>& files,
+                                   const std::vector<WalkEntry>& changed) {
+        if (!index_file.empty()) {
+            PathTable paths;
+            for (const auto& file : files) {
+                paths.addFile(file.path);
+            }
+            paths.seal();
+            if (!NameIndex::build(paths, index_file)) {
+                throw std::runtime_error("Cannot write name index: " + index_file.string());
+            }
+        }
+        
+        if (!hash_cache_file_.empty() && !changed.empty()) {
+            // Частичный хэш нужен -d для любой группы одного размера, поэтому
+            // он считается заранее; полные хэши по-прежнему считает -d
+            HashCache cache(hash_cache_file_);
+            pool_->parallelFor(changed.size(), 16, [&](size_t, size_t index) {
+                Digest digest;
+                if (changed[index].size == 0 ||
+                    cache.lookup(changed[index], hash_algorithm_, HashCache::Kind::Partial, digest)) {
+                    return;
+                }
+                digest = HashCalculator::calculatePartialHash(changed[index].path, changed[index].size,
+                                                              hash_algorithm_);
+                if (!digest.empty()) {
+                    cache.store(changed[index], hash_algorithm_, HashCache::Kind::Partial, digest);
+                }
+            });
+            if (!cache.save()) {
+                throw std::runtime_error("Cannot write hash cache: " + hash_cache_file_.string());
+            }
+        }
+        
+        if (show_progress_) {
+            std::cout << "Checkpoint: " << files.size() << " files, " << changed.size()
+                      << " changed, full rescans: " << daemon.fullRescans() << std::endl;
+        }
     });
 }
 
 std::vector<std::string> FileSearcher::searchByContent(const std::string& pattern) {
     auto files = collectAllFiles();
+    auto compiled = compileContentPattern(pattern);
+    return scanContent(files, compiled);
+}
+
+std::vector<std::string> FileSearcher::scanContent(const PathTable& files, const ContentPattern& pattern) {
+    if (AsyncReader::compiledWithIoUring()) {
+        return scanContentAsync(files, pattern);
+    }
     
-    std::regex re;
-    try {
-        auto flags = case_sensitive_ ? std::regex_constants::ECMAScript
-                                     : std::regex_constants::icase;
-        re = std::regex(pattern, flags);
-    } catch (const std::regex_error& e) {
-        throw std::runtime_error("Invalid regex pattern: " + std::string(e.what()));
+    return processParallel(files, [this, &pattern](const std::string& file) {
+        return contentMatches(file, pattern);
+    });
+}
+
+std::string FileSearcher::contentIndexPath(const std::string& canonical_root, const fs::path& file) const {
+    // Обход строит пути как root_path_ / имя, поэтому корень - общий префикс всех путей
+    const std::string& path = file.native();
+    size_t rest = std::min(root_path_.native().size(), path.size());
+    while (rest < path.size() && path[rest] == fs::path::preferred_separator) {
+        ++rest;
     }
     
-    return processParallel(files, [&re](const fs::path& file) {
-        try {
-            std::ifstream stream(file);
-            if (!stream) return false;
+    std::string key = canonical_root;
+    if (key.empty() || key.back() != fs::path::preferred_separator) {
+        key += fs::path::preferred_separator;
+    }
+    key.append(path, rest, std::string::npos);
+    return key;
+}
+
+size_t FileSearcher::buildContentIndex(const fs::path& index_file) {
+    const std::string canonical_root = fs::canonical(root_path_).native();
+    auto entries = collectEntries(nullptr, true);
+    // id в индексе - позиция в порядке путей, запрос ищет по пути двоичным поиском.
+    // Префикс корня у всех путей общий, так что порядок ключей тот же
+    std::sort(entries.begin(), entries.end(), [](const WalkEntry& a, const WalkEntry& b) {
+        return a.path.native() < b.path.native();
+    });
+    
+    struct Scanned {
+        ContentIndex::State state = ContentIndex::State::Unindexed;
+        std::vector<uint32_t> trigrams;
+    };
+    
+    const size_t workers = pool_->size();
+    std::vector<ContentIndex::TrigramCollector> collectors(workers);
+    std::vector<Scanned> batch(workers * kContentIndexBatch);
+    ContentIndex::Builder builder;
+    ProgressVisualizer progress("Indexing content", entries.size());
+    
+    // Пакетами: триграммы всех файлов сразу в памяти не держатся
+    for (size_t begin = 0; begin < entries.size(); begin += batch.size()) {
+        const size_t count = std::min(batch.size(), entries.size() - begin);
+        pool_->parallelFor(count, 1, [&](size_t worker, size_t index) {
+            Scanned& scanned = batch[index];
+            scanned.trigrams.clear();
             
-            std::string line;
-            while (std::getline(stream, line)) {
-                if (std::regex_search(line, re)) {
-                    return true;
+            ContentReader content(entries[begin + index].path);
+            if (!content.ok()) {
+                scanned.state = ContentIndex::State::Unindexed;
+            } else if (content.isBinary()) {
+                scanned.state = ContentIndex::State::Binary;
+            } else {
+                scanned.state = ContentIndex::State::Indexed;
+                scanned.trigrams = collectors[worker].collect(content.data(), content.size());
+            }
+        });
+        
+        for (size_t i = 0; i < count; ++i) {
+            builder.add(contentIndexPath(canonical_root, entries[begin + i].path), entries[begin + i],
+                        batch[i].state, batch[i].trigrams);
+        }
+        if (show_progress_) {
+            progress.update(begin + count);
+        }
+    }
+    
+    if (show_progress_) {
+        progress.complete();
+    }
+    
+    if (!builder.write(index_file)) {
+        throw std::runtime_error("Cannot write content index: " + index_file.string());
+    }
+    return entries.size();
+}
+
+std::vector<std::string> FileSearcher::searchByContentIndexed(const std::string& pattern,
+                                                              const fs::path& index_file) {
+    auto compiled = compileContentPattern(pattern);
+    ContentIndex index(index_file);
+    
+    std::vector<char> candidate(index.size(), 0);
+    for (uint32_t id : index.candidates(extractRequiredLiterals(pattern))) {
+        candidate[id] = 1;
+    }
+    
+    // Обход только с stat: содержимое читается у кандидатов и у файлов,
+    // которых индекс не знает или которые изменились после построения
+    const std::string canonical_root = fs::canonical(root_path_).native();
+    auto entries = collectEntries(nullptr, true);
+    PathTable files;
+    for (auto& entry : entries) {
+        const uint32_t id = index.find(contentIndexPath(canonical_root, entry.path));
+        bool scan = true;
+        if (id != ContentIndex::kNotFound && index.fresh(id, entry)) {
+            switch (index.state(id)) {
+                case ContentIndex::State::Indexed:   scan = candidate[id]; break;
+                case ContentIndex::State::Binary:    scan = binary_mode_ != BinaryMode::Skip; break;
+                case ContentIndex::State::Unindexed: scan = true; break;
+            }
+        }
+        if (scan) {
+            files.addFile(entry.path);
+        }
+    }
+    entries.clear();
+    files.seal();
+    
+    return scanContent(files, compiled);
+}
+
+std::vector<std::string> FileSearcher::scanContentAsync(const PathTable& files,
+                                                        const ContentPattern& pattern) {
+    // Файл, который ядро отдало одним куском, проверяется прямо в
+    // зарегистрированном буфере; склеивать приходится только короткие чтения
+    struct InFlight {
+        size_t id = 0;
+        uint64_t size = 0;
+        bool scanned = false;
+        bool found = false;
+        std::string content;
+    };
+    
+    std::atomic<size_t> next{0};
+    std::vector<std::vector<uint32_t>> matched(pool_->size());
+    
+    pool_->run([&](size_t worker) {
+        AsyncReader reader;
+        // Всё крупнее одного куска читает ContentReader: там mmap или буфер потока
+        reader.setMaxSize(AsyncReader::kChunkSize);
+        
+        std::vector<InFlight> in_flight;
+        auto find = [&in_flight](size_t id) {
+            return std::find_if(in_flight.begin(), in_flight.end(),
+                                [id](const InFlight& file) { return file.id == id; });
+        };
+        auto scan = [&](InFlight& file, const char* begin, size_t size) {
+            file.scanned = true;
+            const size_t sniff = std::min(size, ContentReader::kSniffSize);
+            if (binary_mode_ != BinaryMode::Skip || !ContentReader::looksBinary(begin, sniff)) {
+                file.found = contentMatches(begin, begin + size, pattern);
+            }
+        };
+        
+        reader.setOpenCallback([&](size_t id, uint64_t size) {
+            InFlight file;
+            file.id = id;
+            file.size = size;
+            // Обход шёл без stat, поэтому --max-size проверяется по размеру открытого файла
+            file.scanned = size > max_file_size_;
+            in_flight.push_back(std::move(file));
+        });
+        
+        reader.read(
+            [&](size_t& id, fs::path& path) {
+                id = next.fetch_add(1, std::memory_order_relaxed);
+                if (id >= files.size()) return false;
+                path = files.path(static_cast<uint32_t>(id));
+                return true;
+            },
+            [&](size_t id, const unsigned char* data, size_t size) {
+                auto file = find(id);
+                if (file == in_flight.end() || file->scanned) return;
+                const char* begin = reinterpret_cast<const char*>(data);
+                if (file->content.empty() && size >= file->size) {
+                    scan(*file, begin, size);
+                } else {
+                    file->content.append(begin, size);
+                }
+            },
+            [&](size_t id, AsyncReader::Status status) {
+                bool found = false;
+                auto file = find(id);
+                if (status == AsyncReader::Status::Skipped) {
+                    found = contentMatches(files.path(static_cast<uint32_t>(id)), pattern);
+                } else if (status == AsyncReader::Status::Ok && file != in_flight.end()) {
+                    if (!file->scanned) {
+                        scan(*file, file->content.data(), file->content.size());
+                    }
+                    found = file->found;
+                }
+                if (file != in_flight.end()) {
+                    std::swap(*file, in_flight.back());
+                    in_flight.pop_back();
+                }
+                if (found) {
+                    matched[worker].push_back(static_cast<uint32_t>(id));
+                }
+            });
+    });
+    
+    std::vector<uint32_t> ids;
+    for (const auto& worker_ids : matched) {
+        ids.insert(ids.end(), worker_ids.begin(), worker_ids.end());
+    }
+    return pathStrings(files, ids);
+}
+
+size_t FileSearcher::searchByName(const std::string& pattern, const MatchCallback& on_match) {
+    auto re = compileRegex(pattern);
+    
+    return processStreaming([](const fs::path&) { return true; }, on_match,
+        [&re](const fs::path& file) {
+            return re.search(file.filename().string());
+        });
+}
+
+size_t FileSearcher::searchByContent(const std::string& pattern, const MatchCallback& on_match) {
+    auto compiled = compileContentPattern(pattern);
+    
+    return processStreaming([this, &compiled](const fs::path& file) {
+        return contentMatches(file, compiled);
+    }, on_match);
+}
+
+std::vector<FileSearcher::PatternHits> FileSearcher::searchByContent(
+    const std::vector<std::string>& patterns) {
+    
+    std::vector<std::string> literals;
+    std::vector<size_t> literal_ids;
+    std::vector<std::pair<size_t, ContentPattern>> regexes;
+    
+    for (size_t id = 0; id < patterns.size(); ++id) {
+        std::string literal;
+        if (isLiteralPattern(patterns[id], literal)) {
+            literals.push_back(std::move(literal));
+            literal_ids.push_back(id);
+        } else {
+            regexes.emplace_back(id, compileContentPattern(patterns[id]));
+        }
+    }
+    
+    std::unique_ptr<AhoCorasick> automaton;
+    if (!literals.empty()) {
+        automaton = std::make_unique<AhoCorasick>(literals, case_sensitive_);
+    }
+    
+    auto files = collectAllFiles();
+    if (files.empty() || patterns.empty()) {
+        return {};
+    }
+    
+    const size_t workers = pool_->size();
+    const size_t chunk = std::clamp<size_t>(files.size() / (workers * 16), 1, 64);
+    std::vector<std::vector<PatternHits>> per_worker(workers);
+    std::vector<std::vector<char>> literal_found(workers);
+    std::vector<std::string> paths(workers);
+    
+    pool_->parallelFor(files.size(), chunk, [&](size_t worker, size_t index) {
+        files.writePath(static_cast<uint32_t>(index), paths[worker]);
+        ContentReader content(paths[worker], max_file_size_);
+        if (!shouldScan(content)) return;
+        
+        const char* begin = content.data();
+        const char* end = begin + content.size();
+        PatternHits hits;
+        
+        if (automaton) {
+            auto& found = literal_found[worker];
+            found.assign(literals.size(), 0);
+            if (automaton->scan(begin, end, found) > 0) {
+                for (size_t i = 0; i < found.size(); ++i) {
+                    if (found[i]) hits.patterns.push_back(literal_ids[i]);
                 }
             }
+        }
+        
+        for (const auto& [id, pattern] : regexes) {
+            if (contentMatches(begin, end, pattern)) {
+                hits.patterns.push_back(id);
+            }
+        }
+        
+        if (!hits.patterns.empty()) {
+            std::sort(hits.patterns.begin(), hits.patterns.end());
+            hits.path = paths[worker];
+            per_worker[worker].push_back(std::move(hits));
+        }
+    });
+    
+    // Как и у одиночного шаблона, стабильный порядок - по пути
+    std::vector<PatternHits> results;
+    for (auto& worker_hits : per_worker) {
+        std::move(worker_hits.begin(), worker_hits.end(), std::back_inserter(results));
+    }
+    std::sort(results.begin(), results.end(),
+              [](const PatternHits& a, const PatternHits& b) { return a.path < b.path; });
+    return results;
+}
+
+template<typename Func>
+std::vector<Digest> FileSearcher::hashParallel(const std::vector<WalkEntry>& files,
+                                               ProgressVisualizer& progress, Func hash) {
+    std::vector<Digest> hashes(files.size());
+    
+    // По одному файлу за раз: длинный файл не задерживает очередь за собой
+    pool_->parallelFor(files.size(), 1, [&](size_t, size_t index) {
+        try {
+            hashes[index] = hash(files[index]);
         } catch (const std::exception& e) {
-            // Игнорирование файлов, если не прочитали
+            // Файл с ошибкой остаётся с пустым хэшем и не попадает в группы
         }
-        return false;
+        
+        if (show_progress_) {
+            progress.increment();
+        }
+    });
+    
+    return hashes;
+}
+
+template<typename Func>
+std::vector<Digest> FileSearcher::hashCached(const std::vector<WalkEntry>& files, HashCache* cache,
+                                             HashCache::Kind kind, ProgressVisualizer& progress,
+                                             Func hash_files) {
+    if (!cache) {
+        return hash_files(files);
+    }
+    
+    std::vector<Digest> hashes(files.size());
+    std::vector<WalkEntry> missing;
+    std::vector<size_t> missing_index;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (cache->lookup(files[i], hash_algorithm_, kind, hashes[i])) {
+            if (show_progress_) {
+                progress.increment();
+            }
+        } else {
+            missing.push_back(files[i]);
+            missing_index.push_back(i);
+        }
+    }
+    
+    auto computed = hash_files(missing);
+    for (size_t i = 0; i < missing.size(); ++i) {
+        if (!computed[i].empty()) {
+            cache->store(missing[i], hash_algorithm_, kind, computed[i]);
+        }
+        hashes[missing_index[i]] = std::move(computed[i]);
+    }
+    return hashes;
+}
+
+std::vector<Digest> FileSearcher::hashAsync(const std::vector<WalkEntry>& files,
+                                            ProgressVisualizer& progress) {
+    std::vector<Digest> hashes(files.size());
+    std::atomic<size_t> next{0};
+    
+    // Каждый поток держит в полёте несколько файлов сразу, поэтому
+    // очередь устройства заполняется без лишних потоков
+    pool_->run([&](size_t) {
+        AsyncReader reader;
+        std::unordered_map<size_t, std::unique_ptr<Hasher>> hashers;
+        reader.setOpenCallback([&](size_t id, uint64_t) {
+            hashers[id] = HashCalculator::createHasher(hash_algorithm_);
+        });
+        
+        reader.read(
+            [&](size_t& id, fs::path& path) {
+                id = next.fetch_add(1, std::memory_order_relaxed);
+                if (id >= files.size()) return false;
+                path = files[id].path;
+                return true;
+            },
+            [&](size_t id, const unsigned char* data, size_t size) {
+                hashers[id]->update(data, size);
+            },
+            [&](size_t id, AsyncReader::Status status) {
+                auto it = hashers.find(id);
+                if (it != hashers.end()) {
+                    if (status == AsyncReader::Status::Ok) {
+                        hashes[id] = it->second->finalize();
+                    }
+                    hashers.erase(it);
+                }
+                if (show_progress_) {
+                    progress.increment();
+                }
+            });
+    });
+    
+    return hashes;
+}
+
+std::vector<Digest> FileSearcher::hashMD5Batches(const std::vector<WalkEntry>& files,
+                                                 ProgressVisualizer& progress) {
+    std::vector<Digest> hashes(files.size());
+    
+    // Пачка заполняет полосы SIMD с запасом на подмену закончившихся файлов,
+    // но не больше, чем нужно, чтобы занять все потоки пула
+    const size_t lanes = HashCalculator::md5BatchLanes();
+    const size_t per_worker = (files.size() + pool_->size() - 1) / pool_->size();
+    const size_t batch = std::max<size_t>(1, std::min(2 * lanes, per_worker));
+    const size_t batches = (files.size() + batch - 1) / batch;
+    
+    pool_->parallelFor(batches, 1, [&](size_t, size_t index) {
+        const size_t begin = index * batch;
+        const size_t end = std::min(files.size(), begin + batch);
+        
+        std::vector<fs::path> paths;
+        paths.reserve(end - begin);
+        for (size_t i = begin; i < end; ++i) {
+            paths.push_back(files[i].path);
+        }
+        
+        auto batch_hashes = HashCalculator::calculateMD5Batch(paths);
+        std::move(batch_hashes.begin(), batch_hashes.end(), hashes.begin() + begin);
+        
+        if (show_progress_) {
+            for (size_t i = begin; i < end; ++i) {
+                progress.increment();
+            }
+        }
+    });
+    
+    return hashes;
+}
+
+void FileSearcher::compareDirectly(std::vector<std::vector<WalkEntry>>& groups, HashCache* cache,
+                                   DuplicateReport& report) {
+    size_t total = 0;
+    for (const auto& group : groups) {
+        total += group.size();
+    }
+    ProgressVisualizer progress("Comparing", total);
+    
+    std::vector<std::vector<std::pair<Digest, std::vector<std::string>>>> confirmed(groups.size());
+    pool_->parallelFor(groups.size(), 1, [&](size_t, size_t index) {
+        const auto& group = groups[index];
+        std::vector<fs::path> paths;
+        paths.reserve(group.size());
+        for (const auto& file : group) {
+            paths.push_back(file.path);
+        }
+        
+        const auto hasher = HashCalculator::createHasher(hash_algorithm_);
+        // Полный хэш одинаковых файлов получен при сравнении; в кэше он избавит
+        // группу от чтения в следующий раз. Для мелких файлов частичный хэш и есть полный
+        const auto kind = HashCalculator::partialHashIsFull(group.front().size)
+            ? HashCache::Kind::Partial : HashCache::Kind::Full;
+        for (auto& identical : FileComparator::splitIdentical(paths, *hasher)) {
+            std::vector<std::string> same;
+            for (size_t i : identical.indices) {
+                same.push_back(paths[i].string());
+                if (cache) {
+                    cache->store(group[i], hash_algorithm_, kind, identical.digest);
+                }
+            }
+            confirmed[index].emplace_back(identical.digest, std::move(same));
+        }
+        
+        if (show_progress_) {
+            for (size_t i = 0; i < group.size(); ++i) {
+                progress.increment();
+            }
+        }
+    });
+    
+    for (size_t index = 0; index < groups.size(); ++index) {
+        for (auto& [hash, paths] : confirmed[index]) {
+            addDuplicateGroup(report, hash, std::move(paths), groups[index].front().size);
+        }
+    }
+    
+    if (show_progress_) {
+        progress.complete();
+    }
+}
+
+std::vector<std::vector<size_t>> FileSearcher::splitByHash(const std::vector<Digest>& hashes,
+                                                           size_t begin, size_t end) {
+    std::unordered_map<Digest, std::vector<size_t>, DigestHash> groups;
+    for (size_t i = begin; i < end; ++i) {
+        if (!hashes[i].empty()) {
+            groups[hashes[i]].push_back(i);
+        }
+    }
+    
+    std::vector<std::vector<size_t>> result;
+    for (auto& [hash, indices] : groups) {
+        if (indices.size() > 1) {
+            result.push_back(std::move(indices));
+        }
+    }
+    return result;
+}
+
+void FileSearcher::addDuplicateGroup(DuplicateReport& report, const Digest& digest,
+                                     std::vector<std::string> paths, uintmax_t size) const {
+    // Копии, уже разделяющие экстенты (reflink), места не занимают
+    size_t storage_units = paths.size();
+    if (detect_shared_extents_) {
+        std::unordered_map<std::string, std::vector<std::string>> by_extents;
+        for (const auto& path : paths) {
+            auto signature = extentSignature(path);
+            if (!signature.empty()) {
+                by_extents[signature].push_back(path);
+            }
+        }
+        for (auto& [signature, shared] : by_extents) {
+            if (shared.size() > 1) {
+                storage_units -= shared.size() - 1;
+                report.shared_extents.push_back(std::move(shared));
+            }
+        }
+    }
+    
+    report.reclaimable_bytes += (storage_units - 1) * size;
+    report.duplicates[digest.hex()] = std::move(paths);
+}
+
+std::string FileSearcher::extentSignature(const fs::path& file) {
+#if defined(SEEKFS_HAVE_FIEMAP)
+    const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return {};
+    }
+    
+    constexpr size_t kMaxExtents = 64;
+    std::vector<char> storage(sizeof(struct fiemap) + kMaxExtents * sizeof(struct fiemap_extent));
+    auto* map = reinterpret_cast<struct fiemap*>(storage.data());
+    map->fm_start = 0;
+    map->fm_length = FIEMAP_MAX_OFFSET;
+    map->fm_extent_count = kMaxExtents;
+    
+    const int rc = ::ioctl(fd, FS_IOC_FIEMAP, map);
+    ::close(fd);
+    if (rc != 0 || map->fm_mapped_extents == 0) {
+        return {};
+    }
+    
+    // Подпись - физическое расположение всех экстентов. Если хоть один
+    // экстент не общий или его адрес неизвестен, файл ни с кем не делит место
+    constexpr uint32_t kUnusable = FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC |
+                                   FIEMAP_EXTENT_DATA_INLINE | FIEMAP_EXTENT_ENCODED;
+    std::string signature;
+    bool complete = false;
+    for (uint32_t i = 0; i < map->fm_mapped_extents; ++i) {
+        const auto& extent = map->fm_extents[i];
+        if ((extent.fe_flags & kUnusable) || !(extent.fe_flags & FIEMAP_EXTENT_SHARED)) {
+            return {};
+        }
+        signature += std::to_string(extent.fe_physical) + ':' + std::to_string(extent.fe_length) + ';';
+        complete = extent.fe_flags & FIEMAP_EXTENT_LAST;
+    }
+    return complete ? signature : std::string();
+#else
+    (void)file;
+    return {};
+#endif
+}
+
+void FileSearcher::collapseHardlinks(std::vector<WalkEntry>& files,
+                                     std::vector<std::vector<std::string>>* links) {
+    std::sort(files.begin(), files.end(), [](const WalkEntry& a, const WalkEntry& b) {
+        if (a.device != b.device) return a.device < b.device;
+        if (a.inode != b.inode) return a.inode < b.inode;
+        return a.path < b.path;
     });
+    
+    size_t unique_count = 0;
+    for (size_t begin = 0; begin < files.size();) {
+        size_t end = begin + 1;
+        if (files[begin].inode != 0) {
+            while (end < files.size() && files[end].device == files[begin].device &&
+                   files[end].inode == files[begin].inode) {
+                ++end;
+            }
+        }
+        
+        if (links && end - begin > 1) {
+            std::vector<std::string> group;
+            group.reserve(end - begin);
+            for (size_t i = begin; i < end; ++i) {
+                group.push_back(files[i].path.string());
+            }
+            links->push_back(std::move(group));
+        }
+        
+        if (unique_count != begin) {
+            files[unique_count] = std::move(files[begin]);
+        }
+        ++unique_count;
+        begin = end;
+    }
+    files.resize(unique_count);
 }
 
 std::unordered_map<std::string, std::vector<std::string>> FileSearcher::findDuplicates() {
+    return findDuplicateReport().duplicates;
+}
+
+FileSearcher::DuplicateReport FileSearcher::findDuplicateReport() {
     auto start_time = std::chrono::steady_clock::now();
     
     GraphicsUtils::printHeader("DUPLICATE SEARCH");
@@ -169,79 +1130,276 @@ std::unordered_map<std::string, std::vector<std::string>> FileSearcher::findDupl
         GraphicsUtils::printSection("Phase 1: Collecting files");
     }
     
-    auto files = collectAllFiles();
+    auto files = collectEntries(nullptr, true);
+    const size_t total_files = files.size();
+    DuplicateReport report;
+    
+    // Неизменившиеся с прошлого запуска файлы не читаются вовсе
+    std::unique_ptr<HashCache> cache;
+    if (!hash_cache_file_.empty()) {
+        cache = std::make_unique<HashCache>(hash_cache_file_);
+    }
+    
+    // Жёсткие ссылки на один inode - это один файл: хэшируется только первый путь,
+    // остальные попадают в отдельный отчёт и не считаются копиями
+    collapseHardlinks(files, &report.hardlinks);
     
     if (show_progress_) {
         GraphicsUtils::printSection("Phase 2: Grouping by size");
     }
     
-    std::unordered_map<std::string, std::vector<fs::path>> sizeGroups;
-    ProgressVisualizer size_progress("Size grouping", files.size());
+    // Этап 1: одинаковые файлы обязаны иметь одинаковый размер.
+    // После сортировки группа одного размера - непрерывный диапазон
+    std::sort(files.begin(), files.end(), [](const WalkEntry& a, const WalkEntry& b) {
+        return a.size < b.size;
+    });
+
+    // Хэши из кэша дешевле любого чтения, поэтому такие группы остаются хэшам
+    auto all_cached = [&](size_t begin, size_t end) {
+        if (!cache) return false;
+        const auto kind = HashCalculator::partialHashIsFull(files[begin].size)
+            ? HashCache::Kind::Partial : HashCache::Kind::Full;
+        Digest hash;
+        for (size_t i = begin; i < end; ++i) {
+            if (!cache->lookup(files[i], hash_algorithm_, kind, hash)) return false;
+        }
+        return true;
+    };
     
-    for (const auto& file : files) {
-        try {
-            auto sizeHash = HashCalculator::calculateFileSizeHash(file);
-            sizeGroups[sizeHash].push_back(file);
-            
-            if (show_progress_) {
-                size_progress.increment();
+    std::vector<WalkEntry> candidates;
+    std::vector<size_t> group_ends;
+    std::vector<std::vector<WalkEntry>> direct_groups;
+    for (size_t begin = 0; begin < files.size();) {
+        size_t end = begin + 1;
+        while (end < files.size() && files[end].size == files[begin].size) ++end;
+        
+        if (end - begin > kDirectCompareGroup || (end - begin > 1 && all_cached(begin, end))) {
+            std::move(files.begin() + begin, files.begin() + end, std::back_inserter(candidates));
+            group_ends.push_back(candidates.size());
+        } else if (end - begin > 1) {
+            direct_groups.emplace_back(std::make_move_iterator(files.begin() + begin),
+                                       std::make_move_iterator(files.begin() + end));
+        }
+        begin = end;
+    }
+    files.clear();
+    
+    // Этап 1а: в маленьких группах файлы сравниваются напрямую; разные
+    // обычно расходятся на первом куске, одинаковые подтверждаются побайтово
+    if (show_progress_) {
+        GraphicsUtils::printSection("Phase 3: Comparing small groups byte by byte");
+    }
+    compareDirectly(direct_groups, cache.get(), report);
+    direct_groups.clear();
+    
+    if (show_progress_) {
+        GraphicsUtils::printSection("Phase 4: Hashing first and last blocks");
+    }
+    
+    // Этап 2: группы одного размера делятся по хэшу начала и конца файла.
+    // Для небольших файлов этот хэш уже полный и сразу идёт в результат
+    ProgressVisualizer partial_progress("Partial hashing", candidates.size());
+    auto partial = hashCached(candidates, cache.get(), HashCache::Kind::Partial, partial_progress,
+                              [&](const std::vector<WalkEntry>& files) {
+        return hashParallel(files, partial_progress, [this](const WalkEntry& file) {
+            return HashCalculator::calculatePartialHash(file.path, file.size, hash_algorithm_);
+        });
+    });
+    
+    std::vector<WalkEntry> full_candidates;
+    std::vector<size_t> full_group_ends;
+    
+    size_t group_begin = 0;
+    for (size_t group_end : group_ends) {
+        const bool is_full = HashCalculator::partialHashIsFull(candidates[group_begin].size);
+        
+        for (auto& group : splitByHash(partial, group_begin, group_end)) {
+            if (is_full) {
+                std::vector<std::string> paths;
+                for (size_t index : group) {
+                    paths.push_back(candidates[index].path.string());
+                }
+                addDuplicateGroup(report, partial[group.front()], std::move(paths),
+                                  candidates[group_begin].size);
+            } else {
+                for (size_t index : group) {
+                    full_candidates.push_back(std::move(candidates[index]));
+                }
+                full_group_ends.push_back(full_candidates.size());
             }
-        } catch (const std::exception& e) {
-            // Пропуск файлов с ошибками
         }
+        group_begin = group_end;
     }
     
     if (show_progress_) {
-        size_progress.complete();
-        GraphicsUtils::printSection("Phase 3: Calculating MD5 hashes");
+        partial_progress.complete();
+        GraphicsUtils::printSection("Phase 5: Calculating full hashes");
     }
     
-    std::unordered_map<std::string, std::vector<std::string>> duplicates;
+    // Этап 3: полное чтение только для файлов, совпавших по началу и концу
+    ProgressVisualizer full_progress("Full hashing", full_candidates.size());
+    // Кандидаты отсортированы по размеру, поэтому файлы в одной пачке MD5
+    // заканчиваются почти одновременно и полосы не простаивают
+    auto full = hashCached(full_candidates, cache.get(), HashCache::Kind::Full, full_progress,
+                           [&](const std::vector<WalkEntry>& files) {
+        if (AsyncReader::compiledWithIoUring()) {
+            return hashAsync(files, full_progress);
+        }
+        return hash_algorithm_ == HashAlgorithm::MD5
+            ? hashMD5Batches(files, full_progress)
+            : hashParallel(files, full_progress, [this](const WalkEntry& file) {
+                  return HashCalculator::calculateHash(file.path, hash_algorithm_);
+              });
+    });
     
-    size_t total_candidates = 0;
-    for (const auto& [sizeHash, fileGroup] : sizeGroups) {
-        if (fileGroup.size() > 1) {
-            total_candidates += fileGroup.size();
+    group_begin = 0;
+    for (size_t group_end : full_group_ends) {
+        for (auto& group : splitByHash(full, group_begin, group_end)) {
+            std::vector<std::string> paths;
+            for (size_t index : group) {
+                paths.push_back(full_candidates[index].path.string());
+            }
+            addDuplicateGroup(report, full[group.front()], std::move(paths),
+                              full_candidates[group_begin].size);
         }
+        group_begin = group_end;
     }
     
-    ProgressVisualizer md5_progress("MD5 calculation", total_candidates);
+    if (cache && !cache->save()) {
+        std::cerr << "⚠️  Failed to write hash cache: " << hash_cache_file_.string() << std::endl;
+    }
     
-    for (const auto& [sizeHash, fileGroup] : sizeGroups) {
-        if (fileGroup.size() > 1) {
-            std::unordered_map<std::string, std::vector<std::string>> md5Groups;
-            
-            for (const auto& file : fileGroup) {
-                try {
-                    auto md5 = HashCalculator::calculateMD5(file);
-                    md5Groups[md5].push_back(file.string());
-                    
-                    if (show_progress_) {
-                        md5_progress.increment();
-                    }
-                } catch (const std::exception& e) {
-                    if (show_progress_) {
-                        md5_progress.increment();
-                    }
-                }
+    if (show_progress_) {
+        full_progress.complete();
+        
+        auto end_time = std::chrono::steady_clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count() / 1000.0;
+        
+        GraphicsUtils::printStats(total_files, report.duplicates.size(), elapsed);
+    }
+    
+    return report;
+}
+
+FileSearcher::SimilarityReport FileSearcher::findSimilarFiles(double min_ratio) {
+    auto start_time = std::chrono::steady_clock::now();
+    
+    GraphicsUtils::printHeader("SIMILAR FILE SEARCH");
+    
+    auto files = collectEntries(nullptr, true);
+    files.erase(std::remove_if(files.begin(), files.end(), [](const WalkEntry& file) {
+        return file.size == 0;
+    }), files.end());
+    // Жёсткие ссылки не занимают места и похожими не считаются
+    collapseHardlinks(files, nullptr);
+    
+    if (show_progress_) {
+        GraphicsUtils::printSection("Chunking and hashing files");
+    }
+    
+    struct Chunk {
+        uint64_t fingerprint;
+        uint32_t length;
+    };
+    
+    // Этап 1: каждый файл режется на чанки и каждый чанк хэшируется
+    std::vector<std::vector<Chunk>> chunks(files.size());
+    ProgressVisualizer progress("Chunking", files.size());
+    pool_->parallelFor(files.size(), 1, [&](size_t, size_t index) {
+        ContentReader content(files[index].path);
+        if (content.ok()) {
+            const auto* data = reinterpret_cast<const unsigned char*>(content.data());
+            size_t offset = 0;
+            auto& file_chunks = chunks[index];
+            file_chunks.reserve(content.size() / ContentChunker::kAvgSize + 1);
+            while (offset < content.size()) {
+                const size_t length = ContentChunker::nextChunk(data + offset, content.size() - offset);
+                file_chunks.push_back(Chunk{XXH3::hash(data + offset, length), static_cast<uint32_t>(length)});
+                offset += length;
             }
-            
-            for (const auto& [md5, filePaths] : md5Groups) {
-                if (filePaths.size() > 1) {
-                    duplicates[md5] = filePaths;
-                }
+            // Повторы внутри файла учитываются один раз
+            std::sort(file_chunks.begin(), file_chunks.end(), [](const Chunk& a, const Chunk& b) {
+                return a.fingerprint < b.fingerprint;
+            });
+        }
+        
+        if (show_progress_) {
+            progress.increment();
+        }
+    });
+    
+    if (show_progress_) {
+        progress.complete();
+        GraphicsUtils::printSection("Building chunk index");
+    }
+    
+    // Этап 2: индекс чанк -> файлы; reclaimable считается по всем вхождениям
+    struct ChunkEntry {
+        uint32_t length = 0;
+        uint64_t occurrences = 0;
+        std::vector<uint32_t> files;
+    };
+    std::unordered_map<uint64_t, ChunkEntry> index;
+    SimilarityReport report;
+    std::vector<uintmax_t> distinct_bytes(files.size(), 0);
+    
+    for (size_t file = 0; file < files.size(); ++file) {
+        report.total_bytes += files[file].size;
+        const auto& file_chunks = chunks[file];
+        for (size_t i = 0; i < file_chunks.size(); ++i) {
+            auto& entry = index[file_chunks[i].fingerprint];
+            entry.length = file_chunks[i].length;
+            ++entry.occurrences;
+            if (i > 0 && file_chunks[i].fingerprint == file_chunks[i - 1].fingerprint) {
+                continue;
             }
+            distinct_bytes[file] += file_chunks[i].length;
+            if (entry.files.size() <= kMaxChunkFanout) {
+                entry.files.push_back(static_cast<uint32_t>(file));
+            }
+        }
+    }
+    chunks.clear();
+    
+    // Этап 3: общие байты для каждой пары файлов с общими чанками
+    std::unordered_map<uint64_t, uintmax_t> shared;
+    for (const auto& [fingerprint, entry] : index) {
+        report.reclaimable_bytes += (entry.occurrences - 1) * entry.length;
+        if (entry.files.size() > kMaxChunkFanout) {
+            // В reclaimable такой чанк уже учтён, в парах - нет
+            ++report.common_chunks;
+            report.common_reclaimable_bytes += (entry.occurrences - 1) * entry.length;
+            continue;
+        }
+        if (entry.files.size() < 2) {
+            continue;
+        }
+        for (size_t a = 0; a < entry.files.size(); ++a) {
+            for (size_t b = a + 1; b < entry.files.size(); ++b) {
+                shared[static_cast<uint64_t>(entry.files[a]) << 32 | entry.files[b]] += entry.length;
+            }
+        }
+    }
+    
+    for (const auto& [key, bytes] : shared) {
+        const size_t a = static_cast<size_t>(key >> 32);
+        const size_t b = static_cast<size_t>(key & 0xFFFFFFFFu);
+        const uintmax_t smaller = std::min(distinct_bytes[a], distinct_bytes[b]);
+        const double ratio = smaller ? static_cast<double>(bytes) / static_cast<double>(smaller) : 0.0;
+        if (ratio >= min_ratio) {
+            report.pairs.push_back(SimilarPair{files[a].path.string(), files[b].path.string(), bytes, ratio});
         }
     }
+    std::sort(report.pairs.begin(), report.pairs.end(), [](const SimilarPair& x, const SimilarPair& y) {
+        return x.shared_bytes > y.shared_bytes;
+    });
     
     if (show_progress_) {
-        md5_progress.complete();
-        
         auto end_time = std::chrono::steady_clock::now();
         auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count() / 1000.0;
         
-        GraphicsUtils::printStats(files.size(), duplicates.size(), elapsed);
+        GraphicsUtils::printStats(files.size(), report.pairs.size(), elapsed);
     }
     
-    return duplicates;
+    return report;
 }
@@ -8,12 +8,30 @@
 #include <vector>
 #include <string>
 #include <filesystem>
-#include <regex>
 #include <unordered_map>
-#include <future>
+#include <memory>
 #include <atomic>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <mutex>
 #include <iostream>
 #include "HashCalculator.h"
+#include "HashCache.h"
+#include "PathTable.h"
+#include "NameIndex.h"
+#include "ContentIndex.h"
+#include "WatchDaemon.h"
+#include "FileComparator.h"
+#include "ContentChunker.h"
+#include "DirectoryWalker.h"
+#include "BoundedQueue.h"
+#include "ThreadPool.h"
+#include "ContentReader.h"
+#include "AsyncReader.h"
+#include "LiteralPrefilter.h"
+#include "RegexEngine.h"
+#include "AhoCorasick.h"
 #include "ProgressVisualizer.h"
 #include "GraphicsUtils.h"
 #include "Spinner.h"
@@ -22,15 +40,121 @@ namespace fs = std::filesystem;
 
 class FileSearcher {
 public:
+    using MatchCallback = std::function<void(const std::string&)>;
+    
+    // Что делать с двоичными файлами при поиске по содержимому
+    enum class BinaryMode {
+        Skip,       // не читать дальше первого блока
+        Text,       // искать как в тексте
+        MatchOnly   // сообщать только факт совпадения, без строк
+    };
+    
+    struct ContentMatch {
+        std::string path;
+        size_t line_number;   // с единицы
+        size_t byte_offset;   // смещение начала строки в файле
+        std::string line;
+        bool binary = false;  // совпадение в двоичном файле, строка не выводится
+    };
+    using LineMatchCallback = std::function<void(const ContentMatch&)>;
+    
+    struct PatternHits {
+        std::string path;
+        std::vector<size_t> patterns; // индексы сработавших шаблонов
+    };
+    
+    struct DuplicateReport {
+        // хэш -> пути одинаковых файлов, по одному пути на inode
+        std::unordered_map<std::string, std::vector<std::string>> duplicates;
+        // пути, ведущие к одному inode (жёсткие ссылки); места не занимают
+        std::vector<std::vector<std::string>> hardlinks;
+        // копии из duplicates, уже разделяющие экстенты (reflink)
+        std::vector<std::vector<std::string>> shared_extents;
+        // сколько освободится, если оставить по одной копии в каждой группе
+        uintmax_t reclaimable_bytes = 0;
+    };
+    
+    struct SimilarPair {
+        std::string first;
+        std::string second;
+        uintmax_t shared_bytes;  // общие различные чанки
+        // shared_bytes / объём различных чанков того из файлов, у которого
+        // он меньше; повторы чанка внутри файла считаются один раз
+        double ratio;
+    };
+    
+    // Чанк, который есть в большем числе файлов (нули, заголовки), не
+    // учитывается в парах, иначе их число растёт квадратично
+    static constexpr size_t kMaxChunkFanout = 64;
+    
+    struct SimilarityReport {
+        std::vector<SimilarPair> pairs;  // по убыванию shared_bytes
+        uintmax_t total_bytes = 0;
+        // сколько освободит дедупликация на уровне чанков
+        uintmax_t reclaimable_bytes = 0;
+        // чанки больше чем в kMaxChunkFanout файлах: входят в
+        // reclaimable_bytes, но не в shared_bytes пар
+        size_t common_chunks = 0;
+        uintmax_t common_reclaimable_bytes = 0;
+    };
+    
     FileSearcher(const std::string& root_path, int num_threads = 4, bool show_progress = false);
     
     std::vector<std::string> searchByName(const std::string& pattern);
     std::vector<std::string> searchByContent(const std::string& pattern);
+    
+    // Индекс имён (NameIndex): build обходит дерево и записывает индекс,
+    // запрос отбирает кандидатов по триграммам литералов шаблона и
+    // проверяет регуляркой только их имена, не обходя файловую систему
+    size_t buildNameIndex(const fs::path& index_file);
+    std::vector<std::string> searchByNameIndexed(const std::string& pattern, const fs::path& index_file);
+    
+    // Индекс содержимого (ContentIndex): при запросе дерево обходится без
+    // чтения, а читаются только кандидаты по триграммам и файлы, у которых
+    // размер или mtime разошлись с индексом или которых в нём нет
+    size_t buildContentIndex(const fs::path& index_file);
+    std::vector<std::string> searchByContentIndexed(const std::string& pattern, const fs::path& index_file);
+    
+    // Режим наблюдения (WatchDaemon) до stop: в каждой контрольной точке
+    // индекс имён index_file (если задан) переписывается из таблицы файлов,
+    // а для изменившихся файлов в кэш хэшей добавляются частичные хэши
+    void watch(const fs::path& index_file, std::chrono::milliseconds interval,
+               const std::atomic<bool>& stop);
     std::unordered_map<std::string, std::vector<std::string>> findDuplicates();
+    DuplicateReport findDuplicateReport();
+    // Дедупликация на уровне чанков (ContentChunker): пары файлов, у
+    // которых общие чанки составляют не меньше min_ratio меньшего файла
+    // (см. SimilarPair::ratio)
+    SimilarityReport findSimilarFiles(double min_ratio = 0.5);
+    
+    // Несколько шаблонов за один проход по каждому файлу: литералы ищутся
+    // общим автоматом Ахо-Корасик, остальные - регулярками по тому же буферу
+    std::vector<PatternHits> searchByContent(const std::vector<std::string>& patterns);
+    
+    // Построчный отчет о совпадениях по мере обхода. max_count ограничивает
+    // число строк на файл, max_results - общее число строк; по достижении
+    // общего лимита обход и обработка сразу останавливаются.
+    size_t reportMatches(const std::string& pattern, const LineMatchCallback& on_match);
+    
+    // Потоковый режим: совпадения передаются в on_match по мере обхода,
+    // вызовы on_match сериализованы. Возвращает число совпадений.
+    size_t searchByName(const std::string& pattern, const MatchCallback& on_match);
+    size_t searchByContent(const std::string& pattern, const MatchCallback& on_match);
     
     void setCaseSensitive(bool sensitive) { case_sensitive_ = sensitive; }
     void setMaxFileSize(size_t max_size) { max_file_size_ = max_size; }
     void setFileTypes(const std::vector<std::string>& types) { file_types_ = types; }
+    void setBinaryMode(BinaryMode mode) { binary_mode_ = mode; }
+    void setHashAlgorithm(HashAlgorithm algorithm) { hash_algorithm_ = algorithm; }
+    // Проверять через FIEMAP, не делят ли копии экстенты (btrfs, XFS)
+    void setDetectSharedExtents(bool detect) { detect_shared_extents_ = detect; }
+    // Файл кэша хэшей между запусками; пустой путь - без кэша
+    void setHashCacheFile(const fs::path& file) { hash_cache_file_ = file; }
+    // Снимок директорий между запусками: неизменившиеся директории не
+    // перечитываются (DirectorySnapshot); пустой путь - без снимка
+    void setDirectorySnapshotFile(const fs::path& file) { dir_snapshot_file_ = file; }
+    void setMaxCount(size_t max_count) { max_count_ = max_count; }
+    void setMaxResults(size_t max_results) { max_results_ = max_results; }
     
 private:
     fs::path root_path_;
@@ -39,14 +163,93 @@ private:
     bool show_progress_ = false;
     size_t max_file_size_ = 100 * 1024 * 1024;
     std::vector<std::string> file_types_;
+    BinaryMode binary_mode_ = BinaryMode::Skip;
+    HashAlgorithm hash_algorithm_ = HashAlgorithm::MD5;
+    bool detect_shared_extents_ = false;
+    fs::path hash_cache_file_;
+    fs::path dir_snapshot_file_;
+    size_t max_count_ = 0;
+    size_t max_results_ = 0;
+    std::unique_ptr<ThreadPool> pool_;
+    
+    static constexpr size_t kStreamQueueCapacity = 4096;
+    // Столько путей поток обхода копит, прежде чем занести их в PathTable
+    static constexpr size_t kInternBatch = 256;
+    // Группы одного размера не больше этой сравниваются побайтово, а не по хэшу
+    static constexpr size_t kDirectCompareGroup = 3;
+    // Столько файлов на поток разбирается на триграммы между записями в индекс
+    static constexpr size_t kContentIndexBatch = 64;
+    
+    struct ContentPattern {
+        Regex regex;
+        // Обязательный литерал шаблона; строки без него регуляркой не проверяются
+        std::unique_ptr<LiteralFinder> prefilter;
+    };
+    
+    void configureWalker(DirectoryWalker& walker,
+                         const DirectoryWalker::FileFilter& name_filter = nullptr,
+                         bool need_size = false) const;
+    // Обход root_path_ через снимок директорий, если он задан
+    void walkRoot(DirectoryWalker& walker, const DirectoryWalker::FileSink& sink,
+                  const std::atomic<bool>* stop = nullptr) const;
+    std::vector<WalkEntry> collectEntries(const DirectoryWalker::FileFilter& name_filter, bool need_size);
+    // Ключ файла в индексе содержимого: путь от канонического корня, чтобы
+    // `-p src`, `-p ./src` и абсолютный путь находили одни и те же записи
+    std::string contentIndexPath(const std::string& canonical_root, const fs::path& file) const;
+    // Только пути: компактная таблица вместо вектора полных путей
+    PathTable collectAllFiles(const DirectoryWalker::FileFilter& name_filter = nullptr);
+    // Пути выбранных файлов, отсортированные по строке пути
+    static std::vector<std::string> pathStrings(const PathTable& files, const std::vector<uint32_t>& ids);
+    Regex compileRegex(const std::string& pattern) const;
+    ContentPattern compileContentPattern(const std::string& pattern) const;
+    bool shouldScan(const ContentReader& content) const;
+    bool contentMatches(const fs::path& file, const ContentPattern& pattern) const;
+    static bool contentMatches(const char* begin, const char* end, const ContentPattern& pattern);
     
-    std::vector<fs::path> collectAllFiles();
-    bool matchesFileType(const fs::path& file);
-    std::vector<std::string> processBatch(
-        const std::vector<fs::path>& batch,
-        const std::function<bool(const fs::path&)>& predicate
-    );
+    // on_line(line_begin, line_end) вызывается для каждой совпавшей строки;
+    // false из on_line прекращает просмотр файла
+    template<typename Func>
+    static void forEachMatchingLine(const char* begin, const char* end,
+                                    const ContentPattern& pattern, Func on_line);
+    std::vector<std::string> scanContent(const PathTable& files, const ContentPattern& pattern);
+    // Поиск по содержимому через AsyncReader: мелкие файлы читаются с
+    // несколькими запросами в полёте, крупные по-прежнему отображаются в память
+    std::vector<std::string> scanContentAsync(const PathTable& files,
+                                              const ContentPattern& pattern);
+    bool matchesFileType(const fs::path& file) const;
+    template<typename Func>
+    std::vector<std::string> processParallel(const PathTable& files, Func func);
+    
+    // Хэши файлов в том же порядке; пустой дайджест - файл не удалось прочитать
+    template<typename Func>
+    std::vector<Digest> hashParallel(const std::vector<WalkEntry>& files,
+                                     ProgressVisualizer& progress, Func hash);
+    // Берёт хэши из кэша, а остальные файлы передаёт hash_files одним списком
+    template<typename Func>
+    std::vector<Digest> hashCached(const std::vector<WalkEntry>& files, HashCache* cache,
+                                   HashCache::Kind kind, ProgressVisualizer& progress,
+                                   Func hash_files);
+    // Полные хэши через AsyncReader: у каждого потока своё кольцо io_uring
+    std::vector<Digest> hashAsync(const std::vector<WalkEntry>& files, ProgressVisualizer& progress);
+    std::vector<Digest> hashMD5Batches(const std::vector<WalkEntry>& files, ProgressVisualizer& progress);
+    // Побайтовое сравнение небольших групп; ключ подтверждённой группы -
+    // хэш её содержимого, посчитанный по кускам во время сравнения; он же
+    // сохраняется в cache
+    void compareDirectly(std::vector<std::vector<WalkEntry>>& groups, HashCache* cache,
+                         DuplicateReport& report);
+    // Оставляет по одному пути на (device, inode); группы ссылок - в links
+    static void collapseHardlinks(std::vector<WalkEntry>& files,
+                                  std::vector<std::vector<std::string>>* links);
+    // Дайджест переводится в hex только здесь, для подтверждённых групп
+    void addDuplicateGroup(DuplicateReport& report, const Digest& digest,
+                           std::vector<std::string> paths, uintmax_t size) const;
+    // Физическое расположение экстентов файла; пустая строка - неизвестно или не общие
+    static std::string extentSignature(const fs::path& file);
+    // Группы из двух и более одинаковых хэшей внутри [begin, end)
+    static std::vector<std::vector<size_t>> splitByHash(const std::vector<Digest>& hashes,
+                                                        size_t begin, size_t end);
     
     template<typename Func>
-    std::vector<std::string> processParallel(const std::vector<fs::path>& files, Func func);
+    size_t processStreaming(Func func, const MatchCallback& on_match,
+                            const DirectoryWalker::FileFilter& name_filter = nullptr);
 };
@@ -67,6 +67,35 @@ public:
         }
     }
     
+    static void printLinkGroups(const vector<vector<string>>& groups, const string& title) {
+        int group_num = 1;
+        for (const auto& files : groups) {
+            cout << endl;
+            cout << title << " #" << group_num << "\n";
+            cout << "`--\n";
+            
+            for (size_t i = 0; i < files.size(); ++i) {
+                cout << "   " << (i == files.size() - 1 ? "`-- " : "|-- ") << files[i] << endl;
+            }
+            group_num++;
+        }
+    }
+    
+    template<typename Pair>
+    static void printSimilarPairs(const vector<Pair>& pairs) {
+        int pair_num = 1;
+        for (const auto& pair : pairs) {
+            cout << endl;
+            cout << "Similar Pair #" << pair_num << " (" << std::fixed << std::setprecision(1)
+                 << pair.ratio * 100.0 << "% shared, " << std::setprecision(2)
+                 << pair.shared_bytes / (1024.0 * 1024.0) << " MB)\n";
+            cout << "`--\n";
+            cout << "   |-- " << pair.first << endl;
+            cout << "   `-- " << pair.second << endl;
+            pair_num++;
+        }
+    }
+    
     static void printStats(size_t files_scanned, size_t duplicates_found, double elapsed_seconds) {
         cout << endl;
         cout << "+----------- Statistics -----------+\n";
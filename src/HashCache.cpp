@@ -0,0 +1,191 @@
+//
+//  HashCache.cpp
+//  SeekFS
+//
+#include "HashCache.h"
+#include "AtomicFile.h"
+#include <fstream>
+#include <iterator>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SEEKFS_HAVE_MMAP 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+    constexpr char kMagic[8] = {'S', 'K', 'F', 'S', 'H', 'C', '0', '2'};
+
+    struct Header {
+        char magic[8];
+        uint32_t record_size;
+        uint32_t reserved;
+        uint64_t count;
+    };
+
+    uint64_t nowNs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+}
+
+HashCache::HashCache(fs::path file, std::chrono::nanoseconds max_age)
+    : file_(std::move(file)), max_age_ns_(static_cast<uint64_t>(max_age.count())) {
+    load();
+}
+
+HashCache::~HashCache() {
+#if defined(SEEKFS_HAVE_MMAP)
+    if (mapping_) {
+        ::munmap(mapping_, mapping_size_);
+    }
+#endif
+}
+
+void HashCache::load() {
+    const char* data = nullptr;
+    size_t size = 0;
+
+#if defined(SEEKFS_HAVE_MMAP)
+    const int fd = ::open(file_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(Header)) {
+        void* mapping = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            mapping_ = mapping;
+            mapping_size_ = static_cast<size_t>(st.st_size);
+            data = static_cast<const char*>(mapping);
+            size = mapping_size_;
+        }
+    }
+    ::close(fd);
+#else
+    std::ifstream in(file_, std::ios::binary);
+    if (!in) {
+        return;
+    }
+    buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    data = buffer_.data();
+    size = buffer_.size();
+#endif
+
+    // Чужой или повреждённый файл просто игнорируется и будет перезаписан
+    if (size < sizeof(Header)) {
+        return;
+    }
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.record_size != sizeof(Record) ||
+        header.count > (size - sizeof(Header)) / sizeof(Record)) {
+        return;
+    }
+
+    const auto* records = reinterpret_cast<const Record*>(data + sizeof(Header));
+    records_ = records;
+    hit_ = std::make_unique<std::atomic<bool>[]>(header.count);
+    loaded_.reserve(header.count);
+    for (uint64_t i = 0; i < header.count; ++i) {
+        const Record& record = records[i];
+        if (record.digest_length == 0 || record.digest_length > kMaxDigest) {
+            continue;
+        }
+        loaded_[Key{record.device, record.inode, record.algorithm, record.kind}] = &record;
+    }
+}
+
+bool HashCache::makeKey(const WalkEntry& file, HashAlgorithm algorithm, Kind kind, Key& key) {
+    // Без идентичности файла и времени изменения запись нельзя проверить
+    if (file.inode == 0 || file.mtime_ns == 0) {
+        return false;
+    }
+    key = Key{file.device, file.inode, static_cast<uint8_t>(algorithm), static_cast<uint8_t>(kind)};
+    return true;
+}
+
+bool HashCache::lookup(const WalkEntry& file, HashAlgorithm algorithm, Kind kind, Digest& digest) const {
+    Key key;
+    if (!makeKey(file, algorithm, kind, key)) {
+        return false;
+    }
+
+    auto it = loaded_.find(key);
+    if (it == loaded_.end()) {
+        return false;
+    }
+    const Record& record = *it->second;
+    if (record.size != file.size || record.mtime_ns != file.mtime_ns) {
+        return false;
+    }
+
+    hit_[&record - records_].store(true, std::memory_order_relaxed);
+    digest = Digest(record.digest, record.digest_length);
+    return true;
+}
+
+void HashCache::store(const WalkEntry& file, HashAlgorithm algorithm, Kind kind, const Digest& digest) {
+    Key key;
+    if (!makeKey(file, algorithm, kind, key) || digest.empty()) {
+        return;
+    }
+
+    Record record{};
+    record.device = key.device;
+    record.inode = key.inode;
+    record.size = file.size;
+    record.mtime_ns = file.mtime_ns;
+    record.seen_ns = nowNs();
+    record.algorithm = key.algorithm;
+    record.kind = key.kind;
+    record.digest_length = digest.size;
+    std::memcpy(record.digest, digest.bytes.data(), digest.size);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    updated_[key] = record;
+}
+
+bool HashCache::save() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Запись о файле, который удалён или давно не попадал в поиск,
+    // доживает до max_age и отбрасывается, чтобы кэш не рос бесконечно
+    const uint64_t now = nowNs();
+    const uint64_t expired_before = now > max_age_ns_ ? now - max_age_ns_ : 0;
+    std::vector<std::pair<const Record*, bool>> records;   // запись, была ли запрошена
+    records.reserve(loaded_.size() + updated_.size());
+    for (const auto& [key, record] : loaded_) {
+        if (updated_.find(key) != updated_.end()) {
+            continue;
+        }
+        const bool hit = hit_[record - records_].load(std::memory_order_relaxed);
+        if (hit || record->seen_ns >= expired_before) {
+            records.emplace_back(record, hit);
+        }
+    }
+    for (const auto& [key, record] : updated_) {
+        records.emplace_back(&record, false);
+    }
+
+    AtomicFile out(file_);
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.record_size = sizeof(Record);
+    header.count = records.size();
+    out.writeValue(header);
+    for (const auto& [record, hit] : records) {
+        if (hit) {
+            Record seen = *record;
+            seen.seen_ns = now;
+            out.writeValue(seen);
+        } else {
+            out.writeValue(*record);
+        }
+    }
+    return out.commit();
+}
@@ -0,0 +1,99 @@
+//
+//  HashCache.h
+//  SeekFS
+//
+#pragma once
+#include <string>
+#include <filesystem>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include "Hasher.h"
+#include "DirectoryWalker.h"
+
+namespace fs = std::filesystem;
+
+// Хэши файлов между запусками. Запись привязана к (st_dev, st_ino) и
+// алгоритму и действительна, пока совпадают размер и mtime в наносекундах.
+// Файл кэша отображается в память целиком; новые хэши копятся отдельно
+// и записываются в save() через AtomicFile. Записи, которые не
+// запрашивались дольше max_age, при сохранении отбрасываются.
+class HashCache {
+public:
+    enum class Kind : uint8_t {
+        Partial, // первый и последний блок (calculatePartialHash)
+        Full
+    };
+
+    explicit HashCache(fs::path file, std::chrono::nanoseconds max_age = std::chrono::hours(24 * 30));
+    ~HashCache();
+
+    HashCache(const HashCache&) = delete;
+    HashCache& operator=(const HashCache&) = delete;
+
+    // Потокобезопасны. lookup видит только то, что было в файле при загрузке
+    bool lookup(const WalkEntry& file, HashAlgorithm algorithm, Kind kind, Digest& digest) const;
+    void store(const WalkEntry& file, HashAlgorithm algorithm, Kind kind, const Digest& digest);
+
+    // Записывает новые хэши и загруженные, которые запрашивались в этом
+    // запуске или не старше max_age; false - файл записать не удалось
+    bool save();
+
+    size_t loadedCount() const { return loaded_.size(); }
+
+private:
+    static constexpr size_t kMaxDigest = Digest::kMaxSize;
+
+    struct Key {
+        uint64_t device;
+        uint64_t inode;
+        uint8_t algorithm;
+        uint8_t kind;
+        bool operator==(const Key& other) const {
+            return device == other.device && inode == other.inode &&
+                   algorithm == other.algorithm && kind == other.kind;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            uint64_t h = key.inode * 0x9E3779B97F4A7C15ull ^ key.device;
+            h ^= (static_cast<uint64_t>(key.algorithm) << 8 | key.kind) * 0xC2B2AE3D27D4EB4Full;
+            return static_cast<size_t>(h ^ (h >> 29));
+        }
+    };
+
+    // Запись на диске; порядок байт - родной для машины
+    struct Record {
+        uint64_t device;
+        uint64_t inode;
+        uint64_t size;
+        uint64_t mtime_ns;
+        uint64_t seen_ns;   // когда запись последний раз запрашивали
+        uint8_t algorithm;
+        uint8_t kind;
+        uint8_t digest_length;
+        uint8_t reserved[5];
+        unsigned char digest[kMaxDigest];
+    };
+
+    fs::path file_;
+    uint64_t max_age_ns_;
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    std::vector<char> buffer_; // без mmap файл читается сюда
+    std::unordered_map<Key, const Record*, KeyHash> loaded_;
+    const Record* records_ = nullptr;
+    std::unique_ptr<std::atomic<bool>[]> hit_;   // по номеру записи в файле
+
+    mutable std::mutex mutex_;
+    std::unordered_map<Key, Record, KeyHash> updated_;
+
+    void load();
+    static bool makeKey(const WalkEntry& file, HashAlgorithm algorithm, Kind kind, Key& key);
+};
@@ -5,8 +5,19 @@
 //  Created by Максим Гоглов on 29.10.2025.
 //
 #include "HashCalculator.h"
+#include "XXH3.h"
+#include "BLAKE3.h"
+#include "CpuFeatures.h"
 #include <cstring>
 #include <algorithm>
+#include <utility>
+
+// Раунды должны раскрываться полностью, иначе индексы регистров не константы
+#if defined(__GNUC__)
+#define MD5_INLINE __attribute__((always_inline)) inline
+#else
+#define MD5_INLINE inline
+#endif
 
 namespace {
     constexpr std::array<uint32_t, 64> S = {
@@ -35,9 +46,218 @@ namespace {
         0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
     };
 
-    constexpr uint32_t left_rotate(uint32_t x, uint32_t n) {
-        return (x << n) | (x >> (32 - n));
+    constexpr size_t messageIndex(size_t i) {
+        return i < 16 ? i : i < 32 ? (5 * i + 1) % 16 : i < 48 ? (3 * i + 5) % 16 : (7 * i) % 16;
+    }
+    
+    // Шаг I из 64. Роли a, b, c, d сдвигаются на каждом шаге, поэтому вместо
+    // перестановки переменных меняются индексы; W - uint32_t или вектор полос
+    template<typename W, size_t I>
+    MD5_INLINE void step(W* v, const W* x) {
+        constexpr size_t a = (4 - I % 4) % 4;
+        constexpr size_t b = (a + 1) % 4;
+        constexpr size_t c = (a + 2) % 4;
+        constexpr size_t d = (a + 3) % 4;
+        
+        W f;
+        if constexpr (I < 16) {
+            f = v[d] ^ (v[b] & (v[c] ^ v[d]));
+        } else if constexpr (I < 32) {
+            f = v[c] ^ (v[d] & (v[b] ^ v[c]));
+        } else if constexpr (I < 48) {
+            f = v[b] ^ v[c] ^ v[d];
+        } else {
+            f = v[c] ^ (v[b] | ~v[d]);
+        }
+        
+        const W t = v[a] + f + K[I] + x[messageIndex(I)];
+        v[a] = v[b] + ((t << S[I]) | (t >> (32 - S[I])));
+    }
+    
+    template<typename W, size_t... I>
+    MD5_INLINE void steps(W* v, const W* x, std::index_sequence<I...>) {
+        (step<W, I>(v, x), ...);
+    }
+    
+    template<typename W>
+    MD5_INLINE void transformBlock(W* state, const W* x) {
+        W v[4] = {state[0], state[1], state[2], state[3]};
+        steps(v, x, std::make_index_sequence<64>());
+        for (size_t i = 0; i < 4; i++) {
+            state[i] += v[i];
+        }
+    }
+    
+    uint32_t readLE32(const unsigned char* p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+    
+#if defined(__GNUC__)
+    // Векторные расширения GCC/Clang: операторы работают над всеми полосами,
+    // поэтому transformBlock годится без изменений
+    typedef uint32_t Lanes4 __attribute__((vector_size(16)));
+    typedef uint32_t Lanes8 __attribute__((vector_size(32)));
+    
+    template<typename W, size_t N>
+    MD5_INLINE void transformLanes(uint32_t (&state)[4][N], const unsigned char* const (&blocks)[N]) {
+        alignas(32) uint32_t words[16][N];
+        for (size_t lane = 0; lane < N; lane++) {
+            for (size_t w = 0; w < 16; w++) {
+                words[w][lane] = readLE32(blocks[lane] + 4 * w);
+            }
+        }
+        
+        W x[16];
+        W v[4];
+        std::memcpy(x, words, sizeof(x));
+        std::memcpy(v, state, sizeof(v));
+        transformBlock(v, x);
+        std::memcpy(state, v, sizeof(v));
+    }
+    
+    void transformLanes4(uint32_t (&state)[4][4], const unsigned char* const (&blocks)[4]) {
+        transformLanes<Lanes4, 4>(state, blocks);
+    }
+    
+#if defined(SEEKFS_AVX2_DISPATCH)
+    SEEKFS_TARGET_AVX2
+    void transformLanes8(uint32_t (&state)[4][8], const unsigned char* const (&blocks)[8]) {
+        transformLanes<Lanes8, 8>(state, blocks);
+    }
+#endif
+    
+    // Файлы раздаются по полосам. Когда файл в полосе заканчивается, его хвост
+    // дохэшируется скалярно, а полоса берёт следующий файл из списка
+    template<size_t N, typename Transform>
+    void hashInLanes(const std::vector<fs::path>& files, std::vector<Digest>& results,
+                     Transform transform) {
+        constexpr size_t kLaneBuffer = 64 * 1024;
+        static const unsigned char kIdleBlock[64] = {};
+        
+        struct LaneInput {
+            std::ifstream stream;
+            std::vector<unsigned char> buffer;
+            size_t file = 0;
+            size_t begin = 0;
+            size_t end = 0;
+            uint64_t processed = 0;
+            bool active = false;
+            bool eof = false;
+        };
+        
+        LaneInput lanes[N];
+        alignas(32) uint32_t state[4][N];
+        size_t next = 0;
+        
+        auto assign = [&](size_t lane) {
+            LaneInput& in = lanes[lane];
+            in.active = false;
+            while (next < files.size()) {
+                in.file = next++;
+                in.stream = std::ifstream(files[in.file], std::ios::binary);
+                if (!in.stream.is_open()) continue;
+                
+                in.buffer.resize(kLaneBuffer);
+                in.begin = in.end = 0;
+                in.processed = 0;
+                in.eof = false;
+                in.active = true;
+                state[0][lane] = 0x67452301;
+                state[1][lane] = 0xefcdab89;
+                state[2][lane] = 0x98badcfe;
+                state[3][lane] = 0x10325476;
+                return;
+            }
+        };
+        
+        auto nextBlock = [&](size_t lane) -> const unsigned char* {
+            LaneInput& in = lanes[lane];
+            while (in.active) {
+                if (in.end - in.begin < 64 && !in.eof) {
+                    std::memmove(in.buffer.data(), in.buffer.data() + in.begin, in.end - in.begin);
+                    in.end -= in.begin;
+                    in.begin = 0;
+                    in.stream.read(reinterpret_cast<char*>(in.buffer.data() + in.end),
+                                   static_cast<std::streamsize>(kLaneBuffer - in.end));
+                    in.end += static_cast<size_t>(in.stream.gcount());
+                    if (in.stream.bad()) {
+                        assign(lane);
+                        continue;
+                    }
+                    in.eof = !in.stream;
+                }
+                
+                if (in.end - in.begin >= 64) {
+                    return in.buffer.data() + in.begin;
+                }
+                
+                const uint32_t lane_state[4] = {state[0][lane], state[1][lane], state[2][lane], state[3][lane]};
+                results[in.file] = MD5::finish(lane_state, in.processed,
+                                               in.buffer.data() + in.begin, in.end - in.begin);
+                assign(lane);
+            }
+            return nullptr;
+        };
+        
+        for (size_t lane = 0; lane < N; lane++) {
+            assign(lane);
+        }
+        
+        while (true) {
+            const unsigned char* blocks[N];
+            bool any = false;
+            for (size_t lane = 0; lane < N; lane++) {
+                blocks[lane] = nextBlock(lane);
+                any |= blocks[lane] != nullptr;
+                if (!blocks[lane]) blocks[lane] = kIdleBlock;
+            }
+            if (!any) break;
+            
+            transform(state, blocks);
+            
+            for (auto& in : lanes) {
+                if (in.active) {
+                    in.begin += 64;
+                    in.processed += 64;
+                }
+            }
+        }
+    }
+#endif
+    
+    Digest hashFile(const fs::path& filePath, Hasher& hasher) {
+        std::ifstream file(filePath, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot open file: " + filePath.string());
+        }
+        
+        const size_t BUFFER_SIZE = 64 * 1024;
+        std::vector<char> fileBuffer(BUFFER_SIZE);
+        
+        while (file.read(fileBuffer.data(), fileBuffer.size()) || file.gcount() > 0) {
+            hasher.update(reinterpret_cast<const unsigned char*>(fileBuffer.data()),
+                          static_cast<size_t>(file.gcount()));
+        }
+        
+        if (file.bad()) {
+            throw std::runtime_error("Error reading file: " + filePath.string());
+        }
+        
+        return hasher.finalize();
+    }
+}
+
+std::string toHex(const unsigned char* bytes, size_t length) {
+    static const char hex_chars[] = "0123456789abcdef";
+    
+    std::string result;
+    result.reserve(length * 2);
+    for (size_t i = 0; i < length; i++) {
+        result += hex_chars[bytes[i] >> 4];
+        result += hex_chars[bytes[i] & 0x0F];
     }
+    return result;
 }
 
 MD5::MD5() : finalized(false) {
@@ -97,7 +317,7 @@ void MD5::update(const std::string& data) {
     update(reinterpret_cast<const unsigned char*>(data.data()), data.length());
 }
 
-std::string MD5::final() {
+Digest MD5::finalize() {
     if (!finalized) {
         unsigned char bits[8];
         encode(count, bits, 8);
@@ -116,52 +336,13 @@ std::string MD5::final() {
     unsigned char digest[16];
     encode(state, digest, 16);
     
-    std::string result;
-    result.reserve(32);
-    
-    static const char hex_chars[] = "0123456789abcdef";
-    for (int i = 0; i < 16; i++) {
-        result += hex_chars[digest[i] >> 4];
-        result += hex_chars[digest[i] & 0x0F];
-    }
-    
-    return result;
+    return Digest(digest, 16);
 }
 
 void MD5::transform(const unsigned char block[64]) {
-    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
     uint32_t x[16];
-    
     decode(block, x, 64);
-    
-    for (uint32_t i = 0; i < 64; i++) {
-        uint32_t f, g;
-        
-        if (i < 16) {
-            f = (b & c) | ((~b) & d);
-            g = i;
-        } else if (i < 32) {
-            f = (d & b) | ((~d) & c);
-            g = (5 * i + 1) % 16;
-        } else if (i < 48) {
-            f = b ^ c ^ d;
-            g = (3 * i + 5) % 16;
-        } else {
-            f = c ^ (b | (~d));
-            g = (7 * i) % 16;
-        }
-        
-        f = f + a + K[i] + x[g];
-        a = d;
-        d = c;
-        c = b;
-        b = b + left_rotate(f, S[i]);
-    }
-    
-    state[0] += a;
-    state[1] += b;
-    state[2] += c;
-    state[3] += d;
+    transformBlock(state, x);
 }
 
 void MD5::encode(const uint32_t* input, unsigned char* output, size_t length) {
@@ -182,6 +363,17 @@ void MD5::decode(const unsigned char* input, uint32_t* output, size_t length) {
     }
 }
 
+Digest MD5::finish(const uint32_t state[4], uint64_t length,
+                   const unsigned char* tail, size_t tail_length) {
+    MD5 ctx;
+    std::memcpy(ctx.state, state, sizeof(ctx.state));
+    const uint64_t bits = length << 3;
+    ctx.count[0] = static_cast<uint32_t>(bits);
+    ctx.count[1] = static_cast<uint32_t>(bits >> 32);
+    ctx.update(tail, tail_length);
+    return ctx.finalize();
+}
+
 std::string MD5::calculate(const std::string& data) {
     MD5 ctx;
     ctx.update(data);
@@ -189,25 +381,8 @@ std::string MD5::calculate(const std::string& data) {
 }
 
 std::string MD5::calculateFile(const fs::path& filePath) {
-    std::ifstream file(filePath, std::ios::binary);
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot open file: " + filePath.string());
-    }
-    
     MD5 ctx;
-    const size_t BUFFER_SIZE = 64 * 1024;
-    std::vector<char> fileBuffer(BUFFER_SIZE);
-    
-    while (file.read(fileBuffer.data(), fileBuffer.size()) || file.gcount() > 0) {
-        ctx.update(reinterpret_cast<const unsigned char*>(fileBuffer.data()),
-                  static_cast<size_t>(file.gcount()));
-    }
-    
-    if (file.bad()) {
-        throw std::runtime_error("Error reading file: " + filePath.string());
-    }
-    
-    return ctx.final();
+    return hashFile(filePath, ctx).hex();
 }
 
 std::string HashCalculator::calculateFileSizeHash(const fs::path& filePath) {
@@ -229,6 +404,86 @@ std::string HashCalculator::calculateFileSizeHash(const fs::path& filePath) {
     }
 }
 
+std::unique_ptr<Hasher> HashCalculator::createHasher(HashAlgorithm algorithm) {
+    switch (algorithm) {
+        case HashAlgorithm::XXH3:
+            return std::make_unique<XXH3>();
+        case HashAlgorithm::BLAKE3:
+            return std::make_unique<BLAKE3>();
+        case HashAlgorithm::MD5:
+            break;
+    }
+    return std::make_unique<MD5>();
+}
+
 std::string HashCalculator::calculateMD5(const fs::path& filePath) {
     return MD5::calculateFile(filePath);
 }
+
+size_t HashCalculator::md5BatchLanes() {
+#if defined(SEEKFS_AVX2_DISPATCH)
+    if (CpuFeatures::hasAVX2()) return 8;
+#endif
+#if defined(__GNUC__)
+    return 4;
+#else
+    return 1;
+#endif
+}
+
+std::vector<Digest> HashCalculator::calculateMD5Batch(const std::vector<fs::path>& files) {
+    std::vector<Digest> results(files.size());
+    
+#if defined(SEEKFS_AVX2_DISPATCH)
+    if (CpuFeatures::hasAVX2()) {
+        hashInLanes<8>(files, results, transformLanes8);
+        return results;
+    }
+#endif
+#if defined(__GNUC__)
+    hashInLanes<4>(files, results, transformLanes4);
+#else
+    for (size_t i = 0; i < files.size(); i++) {
+        try {
+            MD5 ctx;
+            results[i] = hashFile(files[i], ctx);
+        } catch (const std::exception& e) {
+            // Пустой дайджест - файл не удалось прочитать
+        }
+    }
+#endif
+    return results;
+}
+
+Digest HashCalculator::calculateHash(const fs::path& filePath, HashAlgorithm algorithm) {
+    auto hasher = createHasher(algorithm);
+    return hashFile(filePath, *hasher);
+}
+
+Digest HashCalculator::calculatePartialHash(const fs::path& filePath, uintmax_t fileSize,
+                                            HashAlgorithm algorithm) {
+    if (partialHashIsFull(fileSize)) {
+        return calculateHash(filePath, algorithm);
+    }
+    
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open file: " + filePath.string());
+    }
+    
+    auto hasher = createHasher(algorithm);
+    unsigned char block[kPartialHashBlock];
+    
+    file.read(reinterpret_cast<char*>(block), kPartialHashBlock);
+    hasher->update(block, static_cast<size_t>(file.gcount()));
+    
+    file.seekg(static_cast<std::streamoff>(fileSize - kPartialHashBlock));
+    file.read(reinterpret_cast<char*>(block), kPartialHashBlock);
+    hasher->update(block, static_cast<size_t>(file.gcount()));
+    
+    if (file.bad()) {
+        throw std::runtime_error("Error reading file: " + filePath.string());
+    }
+    
+    return hasher->finalize();
+}
@@ -13,17 +13,23 @@
 #include <cstdint>
 #include <vector>
 #include <array>
+#include <memory>
+#include "Hasher.h"
 
 namespace fs = std::filesystem;
 
-class MD5 {
+class MD5 : public Hasher {
 public:
     MD5();
-    void update(const unsigned char* data, size_t length);
+    void update(const unsigned char* data, size_t length) override;
     void update(const std::string& data);
-    std::string final();
+    Digest finalize() override;
+    std::unique_ptr<Hasher> clone() const override { return std::make_unique<MD5>(*this); }
     static std::string calculate(const std::string& data);
     static std::string calculateFile(const fs::path& filePath);
+    // Завершение по состоянию после length байт (кратно 64) и оставшемуся хвосту
+    static Digest finish(const uint32_t state[4], uint64_t length,
+                         const unsigned char* tail, size_t tail_length);
     
 private:
     void transform(const unsigned char block[64]);
@@ -39,6 +45,20 @@ private:
 
 class HashCalculator {
 public:
+    static constexpr size_t kPartialHashBlock = 4096;
+    
+    static std::unique_ptr<Hasher> createHasher(HashAlgorithm algorithm);
+    
     static std::string calculateMD5(const fs::path& filePath);
+    // MD5 нескольких файлов одновременно в полосах SIMD (4 на SSE2, 8 на AVX2).
+    // Порядок результатов совпадает с files; пустой дайджест - ошибка чтения
+    static std::vector<Digest> calculateMD5Batch(const std::vector<fs::path>& files);
+    static size_t md5BatchLanes();
+    static Digest calculateHash(const fs::path& filePath, HashAlgorithm algorithm);
+    // Хэш первого и последнего блока файла. Для файлов не длиннее
+    // двух блоков хэшируется всё содержимое и результат совпадает с calculateHash
+    static Digest calculatePartialHash(const fs::path& filePath, uintmax_t fileSize,
+                                            HashAlgorithm algorithm = HashAlgorithm::MD5);
+    static bool partialHashIsFull(uintmax_t fileSize) { return fileSize <= 2 * kPartialHashBlock; }
     static std::string calculateFileSizeHash(const fs::path& filePath);
 };
@@ -0,0 +1,60 @@
+//
+//  Hasher.h
+//  SeekFS
+//
+#pragma once
+#include <string>
+#include <array>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+enum class HashAlgorithm {
+    MD5,     // совместимость с прежними результатами
+    XXH3,    // быстрый некриптографический 64-битный хэш для группировки
+    BLAKE3   // криптографический хэш для проверки
+};
+
+std::string toHex(const unsigned char* bytes, size_t length);
+
+// Дайджест фиксированного размера без выделений памяти. Поиск дубликатов
+// сравнивает и группирует только их, в hex переводится лишь то, что выводится
+struct Digest {
+    static constexpr size_t kMaxSize = 32;
+    
+    std::array<unsigned char, kMaxSize> bytes{}; // после size - нули
+    uint8_t size = 0;                            // 0 - файл не удалось прочитать
+    
+    Digest() = default;
+    Digest(const unsigned char* data, size_t length) : size(static_cast<uint8_t>(length)) {
+        std::memcpy(bytes.data(), data, length);
+    }
+    
+    bool empty() const { return size == 0; }
+    std::string hex() const { return toHex(bytes.data(), size); }
+    
+    bool operator==(const Digest& other) const { return size == other.size && bytes == other.bytes; }
+    bool operator!=(const Digest& other) const { return !(*this == other); }
+};
+
+// Байты дайджеста и так равномерны, поэтому хватает первых восьми
+struct DigestHash {
+    size_t operator()(const Digest& digest) const {
+        uint64_t value;
+        std::memcpy(&value, digest.bytes.data(), sizeof(value));
+        return static_cast<size_t>(value ^ digest.size);
+    }
+};
+
+// Потоковый хэш: update() вызывается сколько угодно раз, затем один раз
+// finalize() (двоичный дайджест) или final() (он же в hex). clone()
+// копирует состояние, чтобы продолжить общий префикс двумя разными хвостами
+class Hasher {
+public:
+    virtual ~Hasher() = default;
+    virtual void update(const unsigned char* data, size_t length) = 0;
+    virtual Digest finalize() = 0;
+    virtual std::unique_ptr<Hasher> clone() const = 0;
+    std::string final() { return finalize().hex(); }
+};
@@ -0,0 +1,302 @@
+//
+//  LiteralPrefilter.cpp
+//  SeekFS
+//
+#include "LiteralPrefilter.h"
+#include <cstring>
+#include <cctype>
+
+#if defined(__SSE2__) || defined(SEEKFS_AVX2_DISPATCH)
+#include <immintrin.h>
+#endif
+
+namespace {
+    unsigned char asciiLower(unsigned char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c + ('a' - 'A')) : c;
+    }
+
+    unsigned char asciiUpper(unsigned char c) {
+        return (c >= 'a' && c <= 'z') ? static_cast<unsigned char>(c - ('a' - 'A')) : c;
+    }
+
+    // Экранированные символы, которые означают сам символ
+    bool isLiteralEscape(char c) {
+        return std::strchr("^$\\.*+?()[]{}|/-", c) != nullptr;
+    }
+
+    size_t skipClass(const std::string& pattern, size_t i) {
+        size_t j = i + 1;
+        if (j < pattern.size() && pattern[j] == '^') ++j;
+        if (j < pattern.size() && pattern[j] == ']') ++j;
+        while (j < pattern.size() && pattern[j] != ']') {
+            j += (pattern[j] == '\\') ? 2 : 1;
+        }
+        return j + 1;
+    }
+
+    size_t skipGroup(const std::string& pattern, size_t i) {
+        int depth = 0;
+        size_t j = i;
+        while (j < pattern.size()) {
+            const char c = pattern[j];
+            if (c == '\\') {
+                j += 2;
+                continue;
+            }
+            if (c == '[') {
+                j = skipClass(pattern, j);
+                continue;
+            }
+            if (c == '(') ++depth;
+            if (c == ')' && --depth == 0) return j + 1;
+            ++j;
+        }
+        return j;
+    }
+
+    size_t skipEscape(const std::string& pattern, size_t i) {
+        if (i + 1 >= pattern.size()) return pattern.size();
+        const char e = pattern[i + 1];
+        size_t j = i + 2;
+        if (e == 'x') return j + 2;
+        if (e == 'u') return j + 4;
+        if (e == 'c') return j + 1;
+        if (std::isdigit(static_cast<unsigned char>(e))) {
+            while (j < pattern.size() && std::isdigit(static_cast<unsigned char>(pattern[j]))) ++j;
+        }
+        return j;
+    }
+
+    bool hasTopLevelAlternation(const std::string& pattern) {
+        size_t i = 0;
+        while (i < pattern.size()) {
+            const char c = pattern[i];
+            if (c == '\\') {
+                i = skipEscape(pattern, i);
+            } else if (c == '[') {
+                i = skipClass(pattern, i);
+            } else if (c == '(') {
+                i = skipGroup(pattern, i);
+            } else if (c == '|') {
+                return true;
+            } else {
+                ++i;
+            }
+        }
+        return false;
+    }
+}
+
+std::vector<std::string> extractRequiredLiterals(const std::string& pattern) {
+    if (hasTopLevelAlternation(pattern)) {
+        return {};
+    }
+
+    std::vector<std::string> literals;
+    std::string current;
+    auto flush = [&]() {
+        if (!current.empty()) literals.push_back(std::move(current));
+        current.clear();
+    };
+
+    const size_t n = pattern.size();
+    size_t i = 0;
+    while (i < n) {
+        const char c = pattern[i];
+        bool is_literal = false;
+        char literal = 0;
+        size_t atom_end;
+
+        if (c == '\\') {
+            if (i + 1 < n && isLiteralEscape(pattern[i + 1])) {
+                is_literal = true;
+                literal = pattern[i + 1];
+                atom_end = i + 2;
+            } else {
+                atom_end = skipEscape(pattern, i);
+            }
+        } else if (c == '[') {
+            atom_end = skipClass(pattern, i);
+        } else if (c == '(') {
+            atom_end = skipGroup(pattern, i);
+        } else if (std::strchr(".^$)|*+?{}", c)) {
+            atom_end = i + 1;
+        } else {
+            is_literal = true;
+            literal = c;
+            atom_end = i + 1;
+        }
+
+        // Квантификатор после атома решает, обязателен ли он
+        size_t next = atom_end;
+        bool optional = false;
+        bool repeated = false;
+        if (next < n) {
+            const char q = pattern[next];
+            if (q == '*' || q == '?') {
+                optional = true;
+                ++next;
+            } else if (q == '+') {
+                repeated = true;
+                ++next;
+            } else if (q == '{' && next + 1 < n && std::isdigit(static_cast<unsigned char>(pattern[next + 1]))) {
+                optional = pattern[next + 1] == '0' &&
+                           (next + 2 >= n || !std::isdigit(static_cast<unsigned char>(pattern[next + 2])));
+                repeated = true;
+                while (next < n && pattern[next] != '}') ++next;
+                ++next;
+            }
+            if ((optional || repeated) && next < n && pattern[next] == '?') {
+                ++next;
+            }
+        }
+
+        if (is_literal && !optional) {
+            current += literal;
+            if (repeated) flush();
+        } else {
+            flush();
+        }
+        i = next;
+    }
+    flush();
+
+    return literals;
+}
+
+bool isLiteralPattern(const std::string& pattern, std::string& literal) {
+    literal.clear();
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        const char c = pattern[i];
+        if (c == '\\') {
+            if (i + 1 >= pattern.size() || !isLiteralEscape(pattern[i + 1])) return false;
+            literal += pattern[++i];
+        } else if (std::strchr("^$.*+?()[]{}|", c)) {
+            return false;
+        } else {
+            literal += c;
+        }
+    }
+    return true;
+}
+
+LiteralFinder::LiteralFinder(std::string needle, bool case_sensitive)
+    : needle_(std::move(needle)), case_sensitive_(case_sensitive) {
+    const auto first = static_cast<unsigned char>(needle_.empty() ? 0 : needle_.front());
+    const auto last = static_cast<unsigned char>(needle_.empty() ? 0 : needle_.back());
+
+    if (case_sensitive_) {
+        first_lower_ = first_upper_ = first;
+        last_lower_ = last_upper_ = last;
+    } else {
+        first_lower_ = asciiLower(first);
+        first_upper_ = asciiUpper(first);
+        last_lower_ = asciiLower(last);
+        last_upper_ = asciiUpper(last);
+    }
+}
+
+const char* LiteralFinder::find(const char* begin, const char* end) const {
+    if (needle_.empty()) return begin;
+    if (static_cast<size_t>(end - begin) < needle_.size()) return nullptr;
+
+#if defined(SEEKFS_AVX2_DISPATCH)
+    if (CpuFeatures::hasAVX2()) {
+        return findAVX2(begin, end);
+    }
+#endif
+#if defined(__SSE2__)
+    return findSSE2(begin, end);
+#else
+    return findScalar(begin, end);
+#endif
+}
+
+bool LiteralFinder::matchesAt(const char* pos) const {
+    if (case_sensitive_) {
+        return std::memcmp(pos, needle_.data(), needle_.size()) == 0;
+    }
+    for (size_t i = 0; i < needle_.size(); ++i) {
+        if (asciiLower(static_cast<unsigned char>(pos[i])) !=
+            asciiLower(static_cast<unsigned char>(needle_[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* LiteralFinder::findScalar(const char* begin, const char* end) const {
+    const char* last_start = end - needle_.size();
+
+    if (case_sensitive_) {
+        const char* pos = begin;
+        while (pos <= last_start) {
+            pos = static_cast<const char*>(std::memchr(pos, first_lower_, last_start - pos + 1));
+            if (!pos) return nullptr;
+            if (matchesAt(pos)) return pos;
+            ++pos;
+        }
+        return nullptr;
+    }
+
+    for (const char* pos = begin; pos <= last_start; ++pos) {
+        const auto c = static_cast<unsigned char>(*pos);
+        if ((c == first_lower_ || c == first_upper_) && matchesAt(pos)) {
+            return pos;
+        }
+    }
+    return nullptr;
+}
+
+#if defined(__SSE2__)
+const char* LiteralFinder::findSSE2(const char* begin, const char* end) const {
+    const size_t last_offset = needle_.size() - 1;
+    const __m128i first_lo = _mm_set1_epi8(static_cast<char>(first_lower_));
+    const __m128i first_up = _mm_set1_epi8(static_cast<char>(first_upper_));
+    const __m128i last_lo = _mm_set1_epi8(static_cast<char>(last_lower_));
+    const __m128i last_up = _mm_set1_epi8(static_cast<char>(last_upper_));
+
+    const char* pos = begin;
+    for (; pos + 16 + last_offset <= end; pos += 16) {
+        const __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+        const __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos + last_offset));
+        const __m128i eq_first = _mm_or_si128(_mm_cmpeq_epi8(head, first_lo), _mm_cmpeq_epi8(head, first_up));
+        const __m128i eq_last = _mm_or_si128(_mm_cmpeq_epi8(tail, last_lo), _mm_cmpeq_epi8(tail, last_up));
+
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(eq_first, eq_last)));
+        while (mask) {
+            const int bit = __builtin_ctz(mask);
+            if (matchesAt(pos + bit)) return pos + bit;
+            mask &= mask - 1;
+        }
+    }
+    return findScalar(pos, end);
+}
+#endif
+
+#if defined(SEEKFS_AVX2_DISPATCH)
+SEEKFS_TARGET_AVX2
+const char* LiteralFinder::findAVX2(const char* begin, const char* end) const {
+    const size_t last_offset = needle_.size() - 1;
+    const __m256i first_lo = _mm256_set1_epi8(static_cast<char>(first_lower_));
+    const __m256i first_up = _mm256_set1_epi8(static_cast<char>(first_upper_));
+    const __m256i last_lo = _mm256_set1_epi8(static_cast<char>(last_lower_));
+    const __m256i last_up = _mm256_set1_epi8(static_cast<char>(last_upper_));
+
+    const char* pos = begin;
+    for (; pos + 32 + last_offset <= end; pos += 32) {
+        const __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+        const __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos + last_offset));
+        const __m256i eq_first = _mm256_or_si256(_mm256_cmpeq_epi8(head, first_lo), _mm256_cmpeq_epi8(head, first_up));
+        const __m256i eq_last = _mm256_or_si256(_mm256_cmpeq_epi8(tail, last_lo), _mm256_cmpeq_epi8(tail, last_up));
+
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(eq_first, eq_last)));
+        while (mask) {
+            const int bit = __builtin_ctz(mask);
+            if (matchesAt(pos + bit)) return pos + bit;
+            mask &= mask - 1;
+        }
+    }
+    return findScalar(pos, end);
+}
+#endif
@@ -0,0 +1,43 @@
+//
+//  LiteralPrefilter.h
+//  SeekFS
+//
+#pragma once
+#include <string>
+#include <vector>
+#include "CpuFeatures.h"
+
+// Литеральные подстроки, которые обязаны входить в любое совпадение
+// шаблона (подмножество синтаксиса ECMAScript). Пустой результат
+// означает, что обязательных литералов найти не удалось.
+std::vector<std::string> extractRequiredLiterals(const std::string& pattern);
+
+// true, если шаблон - чистый литерал (с учетом экранирования), сам литерал в literal
+bool isLiteralPattern(const std::string& pattern, std::string& literal);
+
+// Поиск подстроки по первому и последнему байту сразу в 32/16 позициях
+// (AVX2/SSE2, выбирается при запуске) с проверкой кандидатов.
+class LiteralFinder {
+public:
+    LiteralFinder(std::string needle, bool case_sensitive);
+
+    const std::string& needle() const { return needle_; }
+
+    // Указатель на начало первого вхождения в [begin, end) или nullptr
+    const char* find(const char* begin, const char* end) const;
+
+private:
+    std::string needle_;
+    bool case_sensitive_;
+    unsigned char first_lower_, first_upper_;
+    unsigned char last_lower_, last_upper_;
+
+    bool matchesAt(const char* pos) const;
+    const char* findScalar(const char* begin, const char* end) const;
+#if defined(__SSE2__)
+    const char* findSSE2(const char* begin, const char* end) const;
+#endif
+#if defined(SEEKFS_AVX2_DISPATCH)
+    SEEKFS_TARGET_AVX2 const char* findAVX2(const char* begin, const char* end) const;
+#endif
+};
@@ -0,0 +1,235 @@
+//
+//  NameIndex.cpp
+//  SeekFS
+//
+#include "NameIndex.h"
+#include "AtomicFile.h"
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <unordered_map>
+#include <stdexcept>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SEEKFS_HAVE_MMAP 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+    constexpr char kMagic[8] = {'S', 'K', 'F', 'S', 'N', 'I', '0', '1'};
+
+    struct Header {
+        char magic[8];
+        uint64_t path_count;
+        uint64_t trigram_count;
+        uint64_t posting_count;
+        uint64_t blob_size;
+    };
+
+    unsigned char foldByte(char c) {
+        const auto byte = static_cast<unsigned char>(c);
+        return byte >= 'A' && byte <= 'Z' ? static_cast<unsigned char>(byte + ('a' - 'A')) : byte;
+    }
+
+    // Различные триграммы строки в нижнем регистре (ASCII)
+    void collectTrigrams(std::string_view text, std::vector<uint32_t>& out) {
+        out.clear();
+        for (size_t i = 0; i + 3 <= text.size(); ++i) {
+            out.push_back(static_cast<uint32_t>(foldByte(text[i])) << 16 |
+                          static_cast<uint32_t>(foldByte(text[i + 1])) << 8 |
+                          foldByte(text[i + 2]));
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+
+    size_t padTo8(size_t size) {
+        return (size + 7) & ~size_t(7);
+    }
+}
+
+bool NameIndex::build(const PathTable& paths, const fs::path& file) {
+    std::vector<PathEntry> entries;
+    entries.reserve(paths.size());
+    std::string blob;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings;
+    std::vector<uint32_t> trigrams;
+    std::string path;
+
+    for (size_t id = 0; id < paths.size(); ++id) {
+        paths.writePath(static_cast<uint32_t>(id), path);
+        const size_t name_length = paths.name(static_cast<uint32_t>(id)).size();
+        const size_t name_offset = path.size() - std::min(name_length, path.size());
+
+        entries.push_back(PathEntry{blob.size(), static_cast<uint32_t>(path.size()),
+                                    static_cast<uint32_t>(name_offset)});
+        blob += path;
+
+        // id растут, поэтому списки получаются отсортированными
+        collectTrigrams(std::string_view(path).substr(name_offset), trigrams);
+        for (uint32_t trigram : trigrams) {
+            postings[trigram].push_back(static_cast<uint32_t>(id));
+        }
+    }
+
+    std::vector<uint32_t> sorted_trigrams;
+    sorted_trigrams.reserve(postings.size());
+    for (const auto& [trigram, ids] : postings) {
+        sorted_trigrams.push_back(trigram);
+    }
+    std::sort(sorted_trigrams.begin(), sorted_trigrams.end());
+
+    std::vector<TrigramEntry> table;
+    table.reserve(sorted_trigrams.size());
+    uint64_t posting_count = 0;
+    for (uint32_t trigram : sorted_trigrams) {
+        const auto& ids = postings[trigram];
+        table.push_back(TrigramEntry{trigram, static_cast<uint32_t>(ids.size()), posting_count});
+        posting_count += ids.size();
+    }
+
+    AtomicFile out(file);
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.path_count = entries.size();
+    header.trigram_count = table.size();
+    header.posting_count = posting_count;
+    header.blob_size = blob.size();
+    out.writeValue(header);
+    out.write(entries.data(), entries.size() * sizeof(PathEntry));
+    out.write(table.data(), table.size() * sizeof(TrigramEntry));
+    for (uint32_t trigram : sorted_trigrams) {
+        const auto& ids = postings[trigram];
+        out.write(ids.data(), ids.size() * sizeof(uint32_t));
+    }
+    static const char kPadding[8] = {};
+    const size_t postings_bytes = posting_count * sizeof(uint32_t);
+    out.write(kPadding, padTo8(postings_bytes) - postings_bytes);
+    out.write(blob.data(), blob.size());
+    return out.commit();
+}
+
+NameIndex::NameIndex(const fs::path& file) {
+    const char* data = nullptr;
+    size_t size = 0;
+
+#if defined(SEEKFS_HAVE_MMAP)
+    const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open name index: " + file.string());
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* mapping = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping != MAP_FAILED) {
+            mapping_ = mapping;
+            mapping_size_ = static_cast<size_t>(st.st_size);
+            data = static_cast<const char*>(mapping);
+            size = mapping_size_;
+        }
+    }
+    ::close(fd);
+#else
+    std::ifstream in(file, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open name index: " + file.string());
+    }
+    buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    data = buffer_.data();
+    size = buffer_.size();
+#endif
+
+    Header header{};
+    if (size >= sizeof(Header)) {
+        std::memcpy(&header, data, sizeof(header));
+    }
+    const uint64_t expected = sizeof(Header) + header.path_count * sizeof(PathEntry) +
+                              header.trigram_count * sizeof(TrigramEntry) +
+                              padTo8(header.posting_count * sizeof(uint32_t)) + header.blob_size;
+    if (size < sizeof(Header) || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || expected != size) {
+        throw std::runtime_error("Invalid name index: " + file.string());
+    }
+
+    const char* pos = data + sizeof(Header);
+    paths_ = reinterpret_cast<const PathEntry*>(pos);
+    pos += header.path_count * sizeof(PathEntry);
+    trigrams_ = reinterpret_cast<const TrigramEntry*>(pos);
+    pos += header.trigram_count * sizeof(TrigramEntry);
+    postings_ = reinterpret_cast<const uint32_t*>(pos);
+    pos += padTo8(header.posting_count * sizeof(uint32_t));
+    blob_ = pos;
+    path_count_ = static_cast<size_t>(header.path_count);
+    trigram_count_ = static_cast<size_t>(header.trigram_count);
+}
+
+NameIndex::~NameIndex() {
+#if defined(SEEKFS_HAVE_MMAP)
+    if (mapping_) {
+        ::munmap(mapping_, mapping_size_);
+    }
+#endif
+}
+
+std::string_view NameIndex::path(uint32_t id) const {
+    const PathEntry& entry = paths_[id];
+    return std::string_view(blob_ + entry.offset, entry.length);
+}
+
+std::string_view NameIndex::name(uint32_t id) const {
+    return path(id).substr(paths_[id].name_offset);
+}
+
+const NameIndex::TrigramEntry* NameIndex::findTrigram(uint32_t trigram) const {
+    const TrigramEntry* end = trigrams_ + trigram_count_;
+    const TrigramEntry* it = std::lower_bound(trigrams_, end, trigram,
+        [](const TrigramEntry& entry, uint32_t value) { return entry.trigram < value; });
+    return it != end && it->trigram == trigram ? it : nullptr;
+}
+
+std::vector<uint32_t> NameIndex::candidates(const std::vector<std::string>& literals) const {
+    std::vector<uint32_t> trigrams;
+    std::vector<uint32_t> all;
+    for (const auto& literal : literals) {
+        collectTrigrams(literal, trigrams);
+        all.insert(all.end(), trigrams.begin(), trigrams.end());
+    }
+    std::sort(all.begin(), all.end());
+    all.erase(std::unique(all.begin(), all.end()), all.end());
+
+    if (all.empty()) {
+        std::vector<uint32_t> ids(path_count_);
+        for (size_t i = 0; i < ids.size(); ++i) {
+            ids[i] = static_cast<uint32_t>(i);
+        }
+        return ids;
+    }
+
+    std::vector<const TrigramEntry*> lists;
+    for (uint32_t trigram : all) {
+        const TrigramEntry* entry = findTrigram(trigram);
+        if (!entry) {
+            return {};
+        }
+        lists.push_back(entry);
+    }
+
+    // Пересечение начинается с самого короткого списка
+    std::sort(lists.begin(), lists.end(), [](const TrigramEntry* a, const TrigramEntry* b) {
+        return a->count < b->count;
+    });
+
+    std::vector<uint32_t> result(postings_ + lists[0]->first, postings_ + lists[0]->first + lists[0]->count);
+    std::vector<uint32_t> next;
+    for (size_t i = 1; i < lists.size() && !result.empty(); ++i) {
+        const uint32_t* begin = postings_ + lists[i]->first;
+        next.clear();
+        std::set_intersection(result.begin(), result.end(), begin, begin + lists[i]->count,
+                              std::back_inserter(next));
+        result.swap(next);
+    }
+    return result;
+}
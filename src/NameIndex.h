@@ -0,0 +1,64 @@
+//
+//  NameIndex.h
+//  SeekFS
+//
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <filesystem>
+#include <cstdint>
+#include <cstddef>
+#include "PathTable.h"
+
+namespace fs = std::filesystem;
+
+// Индекс имён файлов на диске: таблица путей и списки файлов для каждой
+// триграммы имени (в нижнем регистре). Файл индекса отображается в память,
+// запрос читает только нужные списки и не обращается к файловой системе.
+class NameIndex {
+public:
+    // Записывает индекс через AtomicFile; false - не удалось
+    static bool build(const PathTable& paths, const fs::path& file);
+
+    // Бросает std::runtime_error, если индекс не открывается или повреждён
+    explicit NameIndex(const fs::path& file);
+    ~NameIndex();
+
+    NameIndex(const NameIndex&) = delete;
+    NameIndex& operator=(const NameIndex&) = delete;
+
+    size_t size() const { return path_count_; }
+    std::string_view path(uint32_t id) const;
+    std::string_view name(uint32_t id) const;
+
+    // Файлы, в именах которых есть все триграммы литералов (без учёта
+    // регистра), по возрастанию id. Без триграмм - все файлы
+    std::vector<uint32_t> candidates(const std::vector<std::string>& literals) const;
+
+private:
+    struct PathEntry {
+        uint64_t offset;       // начало пути в blob
+        uint32_t length;
+        uint32_t name_offset;  // начало имени внутри пути
+    };
+
+    struct TrigramEntry {
+        uint32_t trigram;
+        uint32_t count;
+        uint64_t first;        // первый элемент в postings
+    };
+
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    std::vector<char> buffer_; // без mmap файл читается сюда
+
+    const PathEntry* paths_ = nullptr;
+    const TrigramEntry* trigrams_ = nullptr;
+    const uint32_t* postings_ = nullptr;
+    const char* blob_ = nullptr;
+    size_t path_count_ = 0;
+    size_t trigram_count_ = 0;
+
+    const TrigramEntry* findTrigram(uint32_t trigram) const;
+};
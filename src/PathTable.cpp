@@ -0,0 +1,91 @@
+//
+//  PathTable.cpp
+//  SeekFS
+//
+#include "PathTable.h"
+#include <algorithm>
+#include <cstring>
+
+const char* PathTable::intern(std::string_view name) {
+    auto it = names_.find(name);
+    if (it != names_.end()) {
+        return it->data();
+    }
+
+    if (block_used_ + name.size() > block_capacity_) {
+        // Остаток блока пропадает, но имена не длиннее PATH_MAX, а блок - мегабайт
+        block_capacity_ = std::max(kBlockSize, name.size());
+        blocks_.push_back(std::make_unique<char[]>(block_capacity_));
+        block_used_ = 0;
+    }
+
+    char* data = blocks_.back().get() + block_used_;
+    std::memcpy(data, name.data(), name.size());
+    block_used_ += name.size();
+    names_.emplace(data, name.size());
+    return data;
+}
+
+uint32_t PathTable::internDirectory(const fs::path& dir) {
+    auto it = dir_ids_.find(dir.native());
+    if (it != dir_ids_.end()) {
+        return it->second;
+    }
+
+    // Корень пути ("/", "dir" в относительном пути) хранится целиком
+    fs::path parent = dir.parent_path();
+    Name node;
+    if (parent.empty() || parent == dir) {
+        const std::string& full = dir.native();
+        node = Name{intern(full), static_cast<uint32_t>(full.size()), kNoParent};
+    } else {
+        const std::string name = dir.filename().string();
+        const uint32_t parent_id = internDirectory(parent);
+        node = Name{intern(name), static_cast<uint32_t>(name.size()), parent_id};
+    }
+
+    const auto id = static_cast<uint32_t>(dirs_.size());
+    dirs_.push_back(node);
+    dir_ids_.emplace(dir.native(), id);
+    return id;
+}
+
+uint32_t PathTable::addFile(const fs::path& path) {
+    const std::string name = path.filename().string();
+    const uint32_t dir = internDirectory(path.parent_path());
+    const auto id = static_cast<uint32_t>(files_.size());
+    files_.push_back(Name{intern(name), static_cast<uint32_t>(name.size()), dir});
+    return id;
+}
+
+void PathTable::seal() {
+    dir_ids_ = {};
+    names_ = {};
+}
+
+void PathTable::appendDirectory(uint32_t dir, std::string& out) const {
+    const Name& node = dirs_[dir];
+    if (node.parent != kNoParent) {
+        appendDirectory(node.parent, out);
+        if (!out.empty() && out.back() != '/') {
+            out.push_back('/');
+        }
+    }
+    out.append(node.data, node.length);
+}
+
+void PathTable::writePath(uint32_t id, std::string& out) const {
+    out.clear();
+    const Name& file = files_[id];
+    appendDirectory(file.parent, out);
+    if (!out.empty() && out.back() != '/') {
+        out.push_back('/');
+    }
+    out.append(file.data, file.length);
+}
+
+std::string PathTable::path(uint32_t id) const {
+    std::string out;
+    writePath(id, out);
+    return out;
+}
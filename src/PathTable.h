@@ -0,0 +1,69 @@
+//
+//  PathTable.h
+//  SeekFS
+//
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <filesystem>
+#include <cstdint>
+#include <cstddef>
+
+namespace fs = std::filesystem;
+
+// Компактная таблица путей: файл - это id директории и имя, директория -
+// id родителя и имя. Имена хранятся один раз в блоках арены, которые не
+// перемещаются, поэтому общие префиксы и повторяющиеся имена не
+// дублируются. Полный путь собирается только когда он нужен.
+class PathTable {
+public:
+    static constexpr uint32_t kNoParent = UINT32_MAX;
+
+    PathTable() = default;
+    PathTable(PathTable&&) = default;
+    PathTable& operator=(PathTable&&) = default;
+
+    // Не потокобезопасен; возвращает id файла (порядковый номер)
+    uint32_t addFile(const fs::path& path);
+
+    size_t size() const { return files_.size(); }
+    bool empty() const { return files_.empty(); }
+    size_t directoryCount() const { return dirs_.size(); }
+
+    std::string path(uint32_t id) const;
+    // Заменяет содержимое out путём файла; без новых выделений памяти,
+    // если ёмкости out хватает
+    void writePath(uint32_t id, std::string& out) const;
+    std::string_view name(uint32_t id) const { return files_[id].name(); }
+
+    // Освобождает словари интернирования, когда файлов больше не будет
+    void seal();
+
+private:
+    struct Name {
+        const char* data;
+        uint32_t length;
+        uint32_t parent;   // id директории: родителя или, для файла, своей
+
+        std::string_view name() const { return {data, length}; }
+    };
+
+    static constexpr size_t kBlockSize = 1 << 20;
+
+    std::vector<Name> dirs_;
+    std::vector<Name> files_;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    size_t block_used_ = 0;
+    size_t block_capacity_ = 0;
+
+    std::unordered_map<std::string, uint32_t> dir_ids_;
+    std::unordered_set<std::string_view> names_;
+
+    const char* intern(std::string_view name);
+    uint32_t internDirectory(const fs::path& dir);
+    void appendDirectory(uint32_t dir, std::string& out) const;
+};
@@ -10,6 +10,7 @@
 #include <string>
 #include <chrono>
 #include <atomic>
+#include <mutex>
 
 class ProgressVisualizer {
 public:
@@ -18,12 +19,14 @@ public:
     
     void update(size_t progress) {
         current_ = progress;
-        display();
+        redraw();
     }
     
+    // Можно вызывать из нескольких потоков: счётчик атомарный, а строку
+    // перерисовывает только тот, кто свободно захватил вывод
     void increment() {
         ++current_;
-        display();
+        redraw();
     }
     
     void set_total(size_t total) {
@@ -31,16 +34,26 @@ public:
     }
     
     void complete() {
+        std::lock_guard<std::mutex> lock(display_mutex_);
         current_ = total_;
         display();
         std::cout << std::endl;
     }
     
 private:
+    void redraw() {
+        std::unique_lock<std::mutex> lock(display_mutex_, std::try_to_lock);
+        if (lock.owns_lock()) {
+            display();
+        }
+    }
+    
+
     void display() {
         if (total_ == 0) return;
         
-        float percentage = static_cast<float>(current_) / total_;
+        const size_t current = current_;
+        float percentage = static_cast<float>(current) / total_;
         auto now = std::chrono::steady_clock::now();
         auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time_).count() / 1000.0;
         
@@ -56,7 +69,7 @@ private:
         }
         
         std::cout << "] " << std::setw(3) << static_cast<int>(percentage * 100) << "%";
-        std::cout << " " << current_ << "/" << total_;
+        std::cout << " " << current << "/" << total_;
         
         if (percentage > 0.01) {
             double eta = elapsed / percentage * (1 - percentage);
@@ -68,6 +81,7 @@ private:
     
     std::string task_name_;
     size_t total_;
-    size_t current_;
+    std::atomic<size_t> current_;
+    std::mutex display_mutex_;
     std::chrono::steady_clock::time_point start_time_;
 };
@@ -0,0 +1,560 @@
+//
+//  RegexEngine.cpp
+//  SeekFS
+//
+#include "RegexEngine.h"
+#include <vector>
+#include <array>
+#include <bitset>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <algorithm>
+#include <cctype>
+
+namespace {
+    using ByteSet = std::bitset<256>;
+
+    // Конструкция без автоматного эквивалента - поиск уходит в std::regex
+    struct UnsupportedPattern {};
+
+    constexpr size_t kMaxNfaStates = 20000;
+    constexpr size_t kMaxDfaStates = 4096;
+    constexpr int kMaxRepeat = 1000;
+    constexpr int kUnknown = -1;
+    constexpr int kCacheFull = -2;
+
+    enum class NodeType { Empty, Set, Bol, Eol, Concat, Alternate, Repeat };
+
+    struct Node {
+        explicit Node(NodeType t) : type(t) {}
+        NodeType type;
+        ByteSet set;
+        std::vector<std::unique_ptr<Node>> children;
+        int min = 0;
+        int max = 0; // -1 - без верхней границы
+    };
+    using NodePtr = std::unique_ptr<Node>;
+
+    ByteSet rangeSet(int from, int to) {
+        ByteSet set;
+        for (int c = from; c <= to; ++c) set.set(static_cast<size_t>(c));
+        return set;
+    }
+
+    ByteSet digitSet() { return rangeSet('0', '9'); }
+
+    ByteSet wordSet() {
+        return rangeSet('a', 'z') | rangeSet('A', 'Z') | rangeSet('0', '9') | rangeSet('_', '_');
+    }
+
+    ByteSet spaceSet() {
+        return rangeSet(' ', ' ') | rangeSet('\t', '\r');
+    }
+
+    void foldCase(ByteSet& set) {
+        for (int c = 'a'; c <= 'z'; ++c) {
+            const int upper = c - 'a' + 'A';
+            if (set.test(c) || set.test(upper)) {
+                set.set(c);
+                set.set(upper);
+            }
+        }
+    }
+
+    int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    class Parser {
+    public:
+        Parser(const std::string& pattern, bool case_sensitive)
+            : pattern_(pattern), icase_(!case_sensitive) {}
+
+        NodePtr parse() {
+            auto root = parseAlternate();
+            if (!eof()) throw UnsupportedPattern{};
+            return root;
+        }
+
+    private:
+        // Экранирование: либо один байт (single >= 0), либо класс
+        struct Escape {
+            ByteSet set;
+            int single = -1;
+        };
+
+        const std::string& pattern_;
+        bool icase_;
+        size_t pos_ = 0;
+
+        bool eof() const { return pos_ >= pattern_.size(); }
+        char peek() const { return pattern_[pos_]; }
+
+        static NodePtr make(NodeType type) { return std::make_unique<Node>(type); }
+
+        NodePtr setNode(ByteSet set) {
+            if (icase_) foldCase(set);
+            auto node = make(NodeType::Set);
+            node->set = set;
+            return node;
+        }
+
+        NodePtr parseAlternate() {
+            auto first = parseConcat();
+            if (eof() || peek() != '|') return first;
+
+            auto alternate = make(NodeType::Alternate);
+            alternate->children.push_back(std::move(first));
+            while (!eof() && peek() == '|') {
+                ++pos_;
+                alternate->children.push_back(parseConcat());
+            }
+            return alternate;
+        }
+
+        NodePtr parseConcat() {
+            auto concat = make(NodeType::Concat);
+            while (!eof() && peek() != '|' && peek() != ')') {
+                concat->children.push_back(parseRepeat());
+            }
+            return concat;
+        }
+
+        NodePtr parseRepeat() {
+            auto atom = parseAtom();
+            while (!eof()) {
+                int min = 0, max = 0;
+                const char c = peek();
+                if (c == '*') {
+                    min = 0; max = -1; ++pos_;
+                } else if (c == '+') {
+                    min = 1; max = -1; ++pos_;
+                } else if (c == '?') {
+                    min = 0; max = 1; ++pos_;
+                } else if (c == '{') {
+                    parseBraces(min, max);
+                } else {
+                    break;
+                }
+                // Ленивые квантификаторы не меняют сам факт совпадения
+                if (!eof() && peek() == '?') ++pos_;
+
+                if (atom->type == NodeType::Bol || atom->type == NodeType::Eol) {
+                    throw UnsupportedPattern{};
+                }
+
+                auto repeat = make(NodeType::Repeat);
+                repeat->min = min;
+                repeat->max = max;
+                repeat->children.push_back(std::move(atom));
+                atom = std::move(repeat);
+            }
+            return atom;
+        }
+
+        int parseNumber() {
+            if (eof() || !std::isdigit(static_cast<unsigned char>(peek()))) throw UnsupportedPattern{};
+            int value = 0;
+            while (!eof() && std::isdigit(static_cast<unsigned char>(peek()))) {
+                value = value * 10 + (peek() - '0');
+                if (value > kMaxRepeat) throw UnsupportedPattern{};
+                ++pos_;
+            }
+            return value;
+        }
+
+        void parseBraces(int& min, int& max) {
+            ++pos_;
+            min = parseNumber();
+            max = min;
+            if (!eof() && peek() == ',') {
+                ++pos_;
+                max = (!eof() && peek() == '}') ? -1 : parseNumber();
+            }
+            if (eof() || peek() != '}') throw UnsupportedPattern{};
+            ++pos_;
+            if (max >= 0 && max < min) throw UnsupportedPattern{};
+        }
+
+        NodePtr parseAtom() {
+            const char c = pattern_[pos_++];
+            switch (c) {
+                case '(': {
+                    if (pattern_.compare(pos_, 2, "?:") == 0) {
+                        pos_ += 2;
+                    } else if (!eof() && peek() == '?') {
+                        throw UnsupportedPattern{};
+                    }
+                    auto inner = parseAlternate();
+                    if (eof() || peek() != ')') throw UnsupportedPattern{};
+                    ++pos_;
+                    return inner;
+                }
+                case '[':
+                    return parseClass();
+                case '.': {
+                    ByteSet any;
+                    any.set();
+                    any.reset('\n');
+                    any.reset('\r');
+                    return setNode(any);
+                }
+                case '^':
+                    return make(NodeType::Bol);
+                case '$':
+                    return make(NodeType::Eol);
+                case '\\': {
+                    Escape escape = parseEscape(false);
+                    return setNode(escape.set);
+                }
+                case '*': case '+': case '?': case '{': case ')':
+                    throw UnsupportedPattern{};
+                default: {
+                    ByteSet set;
+                    set.set(static_cast<unsigned char>(c));
+                    return setNode(set);
+                }
+            }
+        }
+
+        Escape single(int c) {
+            Escape escape;
+            escape.single = c;
+            escape.set.set(static_cast<size_t>(c));
+            return escape;
+        }
+
+        Escape parseEscape(bool in_class) {
+            if (eof()) throw UnsupportedPattern{};
+            const char e = pattern_[pos_++];
+            Escape escape;
+
+            switch (e) {
+                case 'd': escape.set = digitSet(); return escape;
+                case 'D': escape.set = ~digitSet(); return escape;
+                case 'w': escape.set = wordSet(); return escape;
+                case 'W': escape.set = ~wordSet(); return escape;
+                case 's': escape.set = spaceSet(); return escape;
+                case 'S': escape.set = ~spaceSet(); return escape;
+                case 'n': return single('\n');
+                case 'r': return single('\r');
+                case 't': return single('\t');
+                case 'f': return single('\f');
+                case 'v': return single('\v');
+                case 'b':
+                    if (in_class) return single('\b');
+                    throw UnsupportedPattern{};
+                case 'B':
+                    throw UnsupportedPattern{};
+                case '0':
+                    if (!eof() && std::isdigit(static_cast<unsigned char>(peek()))) throw UnsupportedPattern{};
+                    return single(0);
+                case 'x':
+                case 'u': {
+                    const size_t digits = (e == 'x') ? 2 : 4;
+                    if (pos_ + digits > pattern_.size()) throw UnsupportedPattern{};
+                    int value = 0;
+                    for (size_t i = 0; i < digits; ++i) {
+                        const int h = hexValue(pattern_[pos_++]);
+                        if (h < 0) throw UnsupportedPattern{};
+                        value = value * 16 + h;
+                    }
+                    if (value > 0xFF) throw UnsupportedPattern{};
+                    return single(value);
+                }
+                case 'c': {
+                    if (eof() || !std::isalpha(static_cast<unsigned char>(peek()))) throw UnsupportedPattern{};
+                    return single(pattern_[pos_++] % 32);
+                }
+                default:
+                    // \1..\9 - обратные ссылки
+                    if (std::isdigit(static_cast<unsigned char>(e))) throw UnsupportedPattern{};
+                    return single(static_cast<unsigned char>(e));
+            }
+        }
+
+        Escape parseClassAtom() {
+            if (eof()) throw UnsupportedPattern{};
+            const char c = pattern_[pos_++];
+            if (c == '\\') return parseEscape(true);
+            if (c == '[' && !eof() && (peek() == ':' || peek() == '.' || peek() == '=')) {
+                throw UnsupportedPattern{};
+            }
+            return single(static_cast<unsigned char>(c));
+        }
+
+        NodePtr parseClass() {
+            bool negate = false;
+            if (!eof() && peek() == '^') {
+                negate = true;
+                ++pos_;
+            }
+            if (eof() || peek() == ']') throw UnsupportedPattern{};
+
+            ByteSet set;
+            while (true) {
+                if (eof()) throw UnsupportedPattern{};
+                if (peek() == ']') {
+                    ++pos_;
+                    break;
+                }
+
+                Escape from = parseClassAtom();
+                if (from.single >= 0 && pos_ + 1 < pattern_.size() &&
+                    peek() == '-' && pattern_[pos_ + 1] != ']') {
+                    ++pos_;
+                    Escape to = parseClassAtom();
+                    if (to.single < from.single) throw UnsupportedPattern{};
+                    set |= rangeSet(from.single, to.single);
+                } else {
+                    set |= from.set;
+                }
+            }
+
+            // Регистр сворачивается до отрицания: [^a] с icase не совпадает с 'A'
+            if (icase_) foldCase(set);
+            if (negate) set.flip();
+
+            auto node = make(NodeType::Set);
+            node->set = set;
+            return node;
+        }
+    };
+}
+
+struct Regex::Program {
+    enum class Op : uint8_t { Set, Split, Bol, Eol, Match };
+
+    struct State {
+        Op op;
+        int out = -1;
+        int out1 = -1;
+        int set = -1;
+    };
+
+    struct DState {
+        explicit DState(int state_id) : id(state_id) {
+            for (auto& n : next) n.store(kUnknown, std::memory_order_relaxed);
+        }
+        int id;
+        std::vector<int> nfa;
+        bool match = false;
+        bool match_at_end = false;
+        std::array<std::atomic<int>, 256> next;
+    };
+
+    std::vector<State> states;
+    std::vector<ByteSet> sets;
+    int start = -1;
+
+    std::mutex mutex;
+    // Владение состояниями меняется только под mutex. Поиск читает их без
+    // блокировки через таблицу фиксированного размера: указатель публикуется
+    // release-записью до того, как на состояние сошлётся переход
+    std::vector<std::unique_ptr<DState>> owned_dstates;
+    std::unique_ptr<std::atomic<DState*>[]> dstates{new std::atomic<DState*>[kMaxDfaStates]()};
+    std::unordered_map<std::string, int> dstate_index;
+    int start_dstate = -1;
+
+    explicit Program(const Node& root) {
+        const int match = add({Op::Match});
+        start = emit(root, match);
+        owned_dstates.reserve(kMaxDfaStates);
+        start_dstate = intern(closure({start}, true, false), true);
+    }
+
+    int add(State state) {
+        if (states.size() >= kMaxNfaStates) throw UnsupportedPattern{};
+        states.push_back(state);
+        return static_cast<int>(states.size() - 1);
+    }
+
+    // NFA собирается с конца: emit возвращает вход фрагмента, ведущего в next
+    int emit(const Node& node, int next) {
+        switch (node.type) {
+            case NodeType::Empty:
+                return next;
+            case NodeType::Set:
+                sets.push_back(node.set);
+                return add({Op::Set, next, -1, static_cast<int>(sets.size() - 1)});
+            case NodeType::Bol:
+                return add({Op::Bol, next});
+            case NodeType::Eol:
+                return add({Op::Eol, next});
+            case NodeType::Concat:
+                for (auto it = node.children.rbegin(); it != node.children.rend(); ++it) {
+                    next = emit(**it, next);
+                }
+                return next;
+            case NodeType::Alternate: {
+                int entry = emit(*node.children.back(), next);
+                for (size_t i = node.children.size() - 1; i-- > 0;) {
+                    const int branch = emit(*node.children[i], next);
+                    entry = add({Op::Split, branch, entry});
+                }
+                return entry;
+            }
+            case NodeType::Repeat: {
+                const Node& child = *node.children.front();
+                int current = next;
+                if (node.max < 0) {
+                    const int loop = add({Op::Split});
+                    const int body = emit(child, loop);
+                    states[loop].out = body;
+                    states[loop].out1 = next;
+                    current = loop;
+                } else {
+                    for (int i = node.min; i < node.max; ++i) {
+                        const int body = emit(child, current);
+                        current = add({Op::Split, body, next});
+                    }
+                }
+                for (int i = 0; i < node.min; ++i) {
+                    current = emit(child, current);
+                }
+                return current;
+            }
+        }
+        return next;
+    }
+
+    std::vector<int> closure(const std::vector<int>& seeds, bool at_bol, bool at_eol) const {
+        std::vector<char> seen(states.size(), 0);
+        std::vector<int> stack(seeds.rbegin(), seeds.rend());
+        std::vector<int> result;
+
+        while (!stack.empty()) {
+            const int s = stack.back();
+            stack.pop_back();
+            if (s < 0 || seen[s]) continue;
+            seen[s] = 1;
+
+            const State& state = states[s];
+            switch (state.op) {
+                case Op::Split:
+                    stack.push_back(state.out1);
+                    stack.push_back(state.out);
+                    break;
+                case Op::Bol:
+                    if (at_bol) stack.push_back(state.out);
+                    break;
+                case Op::Eol:
+                    if (at_eol) stack.push_back(state.out);
+                    else result.push_back(s);
+                    break;
+                case Op::Set:
+                case Op::Match:
+                    result.push_back(s);
+                    break;
+            }
+        }
+
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    bool containsMatch(const std::vector<int>& set) const {
+        return std::any_of(set.begin(), set.end(), [this](int s) { return states[s].op == Op::Match; });
+    }
+
+    std::vector<int> step(const std::vector<int>& from, unsigned char byte) const {
+        std::vector<int> seeds;
+        for (int s : from) {
+            const State& state = states[s];
+            if (state.op == Op::Set && sets[state.set].test(byte)) {
+                seeds.push_back(state.out);
+            }
+        }
+        // Поиск без привязки к началу: с каждой позиции может начаться совпадение
+        seeds.push_back(start);
+        return closure(seeds, false, false);
+    }
+
+    // Вызывается под mutex
+    int intern(std::vector<int> set, bool is_start) {
+        std::string key(reinterpret_cast<const char*>(set.data()), set.size() * sizeof(int));
+        key.push_back(is_start ? '\1' : '\0');
+
+        auto it = dstate_index.find(key);
+        if (it != dstate_index.end()) return it->second;
+        if (owned_dstates.size() >= kMaxDfaStates) return kCacheFull;
+
+        auto dstate = std::make_unique<DState>(static_cast<int>(owned_dstates.size()));
+        dstate->match = containsMatch(set);
+        dstate->match_at_end = containsMatch(closure(set, is_start, true));
+        dstate->nfa = std::move(set);
+
+        const int id = dstate->id;
+        dstates[id].store(dstate.get(), std::memory_order_release);
+        owned_dstates.push_back(std::move(dstate));
+        dstate_index.emplace(std::move(key), id);
+        return id;
+    }
+
+    int transition(DState& from, unsigned char byte) {
+        std::lock_guard<std::mutex> lock(mutex);
+        int next = from.next[byte].load(std::memory_order_acquire);
+        if (next != kUnknown) return next;
+
+        next = intern(step(from.nfa, byte), false);
+        if (next != kCacheFull) {
+            from.next[byte].store(next, std::memory_order_release);
+        }
+        return next;
+    }
+
+    // Кэш DFA переполнен: дальше идем симуляцией NFA, время остается линейным
+    bool simulate(std::vector<int> current, const char* pos, const char* end) const {
+        for (; pos < end; ++pos) {
+            current = step(current, static_cast<unsigned char>(*pos));
+            if (containsMatch(current)) return true;
+        }
+        return containsMatch(closure(current, false, true));
+    }
+
+    bool search(const char* begin, const char* end) {
+        DState* state = dstates[start_dstate].load(std::memory_order_acquire);
+        if (state->match) return true;
+
+        for (const char* pos = begin; pos < end; ++pos) {
+            const auto byte = static_cast<unsigned char>(*pos);
+            int next = state->next[byte].load(std::memory_order_acquire);
+            if (next == kUnknown) {
+                next = transition(*state, byte);
+                if (next == kCacheFull) {
+                    auto current = step(state->nfa, byte);
+                    return containsMatch(current) || simulate(std::move(current), pos + 1, end);
+                }
+            }
+            state = dstates[next].load(std::memory_order_acquire);
+            if (state->match) return true;
+        }
+        return state->match_at_end;
+    }
+};
+
+Regex::Regex(const std::string& pattern, bool case_sensitive) {
+    // std::regex проверяет синтаксис, чтобы ошибки совпадали с прежними
+    auto flags = case_sensitive ? std::regex_constants::ECMAScript
+                                : std::regex_constants::ECMAScript | std::regex_constants::icase;
+    auto fallback = std::make_shared<const std::regex>(pattern, flags);
+
+    try {
+        Parser parser(pattern, case_sensitive);
+        auto root = parser.parse();
+        program_ = std::make_shared<Program>(*root);
+    } catch (const UnsupportedPattern&) {
+        fallback_ = std::move(fallback);
+    }
+}
+
+bool Regex::search(const char* begin, const char* end) const {
+    if (program_) {
+        return program_->search(begin, end);
+    }
+    return fallback_ && std::regex_search(begin, end, *fallback_);
+}
@@ -0,0 +1,32 @@
+//
+//  RegexEngine.h
+//  SeekFS
+//
+#pragma once
+#include <string>
+#include <regex>
+#include <memory>
+
+// Регулярное выражение с гарантированно линейным временем поиска:
+// шаблон компилируется в NFA Томпсона, а DFA строится лениво и кэшируется
+// между вызовами (в том числе из разных потоков).
+// Поддерживается подмножество ECMAScript: литералы, '.', классы и экранирования
+// \d \w \s, группы, альтернативы, квантификаторы, '^' и '$'. Для конструкций
+// без автоматного эквивалента (обратные ссылки, lookahead, \b) используется
+// std::regex с теми же флагами.
+class Regex {
+public:
+    Regex() = default;
+    Regex(const std::string& pattern, bool case_sensitive);
+
+    bool search(const char* begin, const char* end) const;
+    bool search(const std::string& text) const { return search(text.data(), text.data() + text.size()); }
+
+    bool usesAutomaton() const { return program_ != nullptr; }
+
+private:
+    struct Program;
+
+    std::shared_ptr<Program> program_;
+    std::shared_ptr<const std::regex> fallback_;
+};
@@ -0,0 +1,78 @@
+//
+//  ThreadPool.cpp
+//  SeekFS
+//
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t num_threads) {
+    const size_t extra = std::max<size_t>(1, num_threads) - 1;
+    threads_.reserve(extra);
+    for (size_t i = 0; i < extra; ++i) {
+        threads_.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void ThreadPool::run(const Task& task) {
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        running_ = threads_.size();
+        error_ = nullptr;
+        ++generation_;
+    }
+    start_cv_.notify_all();
+
+    std::exception_ptr local_error;
+    try {
+        task(0);
+    } catch (...) {
+        local_error = std::current_exception();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return running_ == 0; });
+    task_ = nullptr;
+
+    if (local_error) std::rethrow_exception(local_error);
+    if (error_) std::rethrow_exception(error_);
+}
+
+void ThreadPool::workerLoop(size_t worker) {
+    size_t seen_generation = 0;
+
+    while (true) {
+        const Task* task = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_cv_.wait(lock, [&] { return stopping_ || generation_ != seen_generation; });
+            if (stopping_) return;
+            seen_generation = generation_;
+            task = task_;
+        }
+
+        std::exception_ptr error;
+        try {
+            (*task)(worker);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error && !error_) error_ = error;
+        if (--running_ == 0) done_cv_.notify_one();
+    }
+}
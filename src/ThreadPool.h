@@ -0,0 +1,64 @@
+//
+//  ThreadPool.h
+//  SeekFS
+//
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+
+// Постоянный пул потоков. run() выполняет одну задачу на всех потоках
+// сразу (вызывающий поток работает как worker 0) и ждет их завершения.
+class ThreadPool {
+public:
+    using Task = std::function<void(size_t worker)>;
+
+    explicit ThreadPool(size_t num_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return threads_.size() + 1; }
+
+    void run(const Task& task);
+
+    // Динамическая раздача диапазона [0, count) кусками по chunk элементов
+    template<typename Func>
+    void parallelFor(size_t count, size_t chunk, Func func) {
+        if (count == 0) return;
+        if (chunk == 0) chunk = 1;
+
+        std::atomic<size_t> next{0};
+        run([&](size_t worker) {
+            while (true) {
+                const size_t begin = next.fetch_add(chunk, std::memory_order_relaxed);
+                if (begin >= count) break;
+                const size_t end = std::min(count, begin + chunk);
+                for (size_t i = begin; i < end; ++i) {
+                    func(worker, i);
+                }
+            }
+        });
+    }
+
+private:
+    void workerLoop(size_t worker);
+
+    std::vector<std::thread> threads_;
+    std::mutex run_mutex_;
+
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    const Task* task_ = nullptr;
+    size_t generation_ = 0;
+    size_t running_ = 0;
+    bool stopping_ = false;
+    std::exception_ptr error_;
+};
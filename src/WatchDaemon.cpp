@@ -0,0 +1,360 @@
+//
+//  WatchDaemon.cpp
+//  SeekFS
+//
+#include "WatchDaemon.h"
+#include <mutex>
+#include <stdexcept>
+
+#if defined(__linux__)
+#define SEEKFS_HAVE_INOTIFY 1
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace {
+#if defined(SEEKFS_HAVE_INOTIFY)
+    constexpr uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                    IN_CLOSE_WRITE | IN_ATTRIB | IN_ONLYDIR | IN_DONT_FOLLOW |
+                                    IN_EXCL_UNLINK;
+    constexpr int kPollTimeoutMs = 200;
+#endif
+
+    // Префикс путей внутри директории: "dir/"
+    std::string subtreePrefix(const std::string& dir) {
+        return (fs::path(dir) / "").string();
+    }
+
+    template<typename Map, typename Func>
+    void forEachInSubtree(Map& map, const std::string& dir, Func func) {
+        const std::string prefix = subtreePrefix(dir);
+        for (auto it = map.lower_bound(prefix);
+             it != map.end() && it->first.compare(0, prefix.size(), prefix) == 0;) {
+            it = func(it);
+        }
+    }
+}
+
+WatchDaemon::WatchDaemon(fs::path root, int num_threads)
+    : root_(std::move(root)), num_threads_(num_threads) {}
+
+WatchDaemon::~WatchDaemon() {
+#if defined(SEEKFS_HAVE_INOTIFY)
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+#endif
+}
+
+bool WatchDaemon::supported() {
+#if defined(SEEKFS_HAVE_INOTIFY)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void WatchDaemon::run(const std::atomic<bool>& stop, std::chrono::milliseconds interval,
+                      const Checkpoint& checkpoint) {
+#if defined(SEEKFS_HAVE_INOTIFY)
+    fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot initialize inotify");
+    }
+
+    rescanAll();
+    emitCheckpoint(checkpoint);
+    auto last_checkpoint = std::chrono::steady_clock::now();
+
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    while (!stop.load(std::memory_order_relaxed)) {
+        pollfd poll_fd{fd_, POLLIN, 0};
+        if (::poll(&poll_fd, 1, kPollTimeoutMs) > 0) {
+            ssize_t length;
+            while ((length = ::read(fd_, buffer, sizeof(buffer))) > 0) {
+                processEvents(buffer, static_cast<size_t>(length));
+            }
+            // Пары MOVED_FROM/MOVED_TO приходят подряд; непарные - перенос за пределы дерева
+            flushMoves();
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (dirty_ && now - last_checkpoint >= interval) {
+            emitCheckpoint(checkpoint);
+            last_checkpoint = now;
+        }
+    }
+
+    flushMoves();
+    if (dirty_) {
+        emitCheckpoint(checkpoint);
+    }
+#else
+    (void)stop;
+    (void)interval;
+    (void)checkpoint;
+    throw std::runtime_error("Watching is supported only on Linux (inotify)");
+#endif
+}
+
+void WatchDaemon::rescanAll() {
+#if defined(SEEKFS_HAVE_INOTIFY)
+    for (const auto& [wd, dir] : watch_dirs_) {
+        ::inotify_rm_watch(fd_, wd);
+    }
+#endif
+    watch_dirs_.clear();
+    dir_watches_.clear();
+    moves_.clear();
+
+    auto previous = std::move(files_);
+    auto pending = std::move(changed_);
+    files_.clear();
+    scanSubtree(root_.string());
+
+    // Изменёнными считаются только файлы, которые отличаются от прежней
+    // таблицы, плюс ещё не попавшие в контрольную точку
+    changed_ = std::move(pending);
+    for (const auto& [path, entry] : files_) {
+        auto it = previous.find(path);
+        if (it == previous.end() || it->second.size != entry.size ||
+            it->second.mtime_ns != entry.mtime_ns || it->second.inode != entry.inode) {
+            changed_.insert(path);
+        }
+    }
+    dirty_ = true;
+    ++full_rescans_;
+}
+
+void WatchDaemon::scanSubtree(const std::string& dir) {
+    DirectoryWalker walker(num_threads_);
+    walker.setMaxFileSize(max_file_size_);
+    walker.setNeedSize(true);
+    if (filter_) {
+        walker.setFilter(filter_);
+    }
+
+    // Наблюдение ставится до чтения директории, поэтому файлы, созданные
+    // во время обхода, либо попадут в обход, либо придут событием
+    std::mutex watch_mutex;
+    std::vector<std::pair<int, std::string>> watches;
+    walker.setDirectorySink([&](size_t, const fs::path& path) {
+#if defined(SEEKFS_HAVE_INOTIFY)
+        const int wd = ::inotify_add_watch(fd_, path.c_str(), kWatchMask);
+        if (wd >= 0) {
+            std::lock_guard<std::mutex> lock(watch_mutex);
+            watches.emplace_back(wd, path.string());
+        }
+#else
+        (void)path;
+#endif
+    });
+
+    std::vector<std::vector<WalkEntry>> per_worker(walker.workerCount());
+    walker.walk(dir, [&per_worker](size_t worker, WalkEntry&& entry) {
+        per_worker[worker].push_back(std::move(entry));
+    });
+
+    for (auto& [wd, path] : watches) {
+        watch_dirs_[wd] = path;
+        dir_watches_[path] = wd;
+    }
+    for (auto& entries : per_worker) {
+        for (auto& entry : entries) {
+            std::string path = entry.path.string();
+            changed_.insert(path);
+            files_[std::move(path)] = std::move(entry);
+        }
+    }
+    dirty_ = true;
+}
+
+void WatchDaemon::removeSubtree(const std::string& dir) {
+    forEachInSubtree(files_, dir, [this](auto it) {
+        changed_.erase(it->first);
+        dirty_ = true;
+        return files_.erase(it);
+    });
+
+    auto remove_watch = [this](int wd) {
+#if defined(SEEKFS_HAVE_INOTIFY)
+        // У удалённой директории ядро уже сняло наблюдение, ошибка не важна
+        ::inotify_rm_watch(fd_, wd);
+#endif
+        watch_dirs_.erase(wd);
+    };
+    forEachInSubtree(dir_watches_, dir, [&](auto it) {
+        remove_watch(it->second);
+        return dir_watches_.erase(it);
+    });
+    auto self = dir_watches_.find(dir);
+    if (self != dir_watches_.end()) {
+        remove_watch(self->second);
+        dir_watches_.erase(self);
+    }
+}
+
+void WatchDaemon::renameSubtree(const std::string& from, const std::string& to) {
+    const std::string from_prefix = subtreePrefix(from);
+    const std::string to_prefix = subtreePrefix(to);
+    auto rebase = [&](const std::string& path) {
+        return to_prefix + path.substr(from_prefix.size());
+    };
+
+    // Наблюдения привязаны к inode и переезжают вместе с директорией
+    std::vector<std::pair<std::string, int>> moved_dirs;
+    forEachInSubtree(dir_watches_, from, [&](auto it) {
+        moved_dirs.emplace_back(rebase(it->first), it->second);
+        return dir_watches_.erase(it);
+    });
+    auto self = dir_watches_.find(from);
+    if (self != dir_watches_.end()) {
+        moved_dirs.emplace_back(to, self->second);
+        dir_watches_.erase(self);
+    }
+    for (auto& [path, wd] : moved_dirs) {
+        watch_dirs_[wd] = path;
+        dir_watches_[path] = wd;
+    }
+
+    std::vector<std::pair<WalkEntry, bool>> moved_files;
+    forEachInSubtree(files_, from, [&](auto it) {
+        moved_files.emplace_back(std::move(it->second), changed_.erase(it->first) > 0);
+        return files_.erase(it);
+    });
+    for (auto& [entry, changed] : moved_files) {
+        std::string path = rebase(entry.path.string());
+        entry.path = path;
+        if (changed) {
+            changed_.insert(path);
+        }
+        files_[std::move(path)] = std::move(entry);
+    }
+    dirty_ = true;
+}
+
+void WatchDaemon::updateFile(const std::string& path) {
+    WalkEntry entry{path};
+    if ((filter_ && !filter_(entry.path)) || !DirectoryWalker::statFile(entry) ||
+        entry.size > max_file_size_) {
+        removeFile(path);
+        return;
+    }
+
+    auto& slot = files_[path];
+    if (slot.path.empty() || slot.size != entry.size || slot.mtime_ns != entry.mtime_ns ||
+        slot.inode != entry.inode) {
+        slot = std::move(entry);
+        changed_.insert(path);
+        dirty_ = true;
+    }
+}
+
+void WatchDaemon::removeFile(const std::string& path) {
+    if (files_.erase(path)) {
+        changed_.erase(path);
+        dirty_ = true;
+    }
+}
+
+void WatchDaemon::processEvents(const char* buffer, size_t length) {
+#if defined(SEEKFS_HAVE_INOTIFY)
+    for (size_t offset = 0; offset < length;) {
+        const auto* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+        offset += sizeof(struct inotify_event) + event->len;
+
+        if (event->mask & IN_Q_OVERFLOW) {
+            // Какие события потеряны, неизвестно: таблица строится заново
+            rescanAll();
+            continue;
+        }
+
+        auto dir = watch_dirs_.find(event->wd);
+        if (dir == watch_dirs_.end()) {
+            continue;
+        }
+        if (event->mask & IN_IGNORED) {
+            auto watch = dir_watches_.find(dir->second);
+            if (watch != dir_watches_.end() && watch->second == event->wd) {
+                dir_watches_.erase(watch);
+            }
+            watch_dirs_.erase(dir);
+            continue;
+        }
+        if (event->len == 0) {
+            continue;
+        }
+
+        const std::string path = (fs::path(dir->second) / event->name).string();
+        const bool directory = event->mask & IN_ISDIR;
+
+        if (event->mask & IN_MOVED_FROM) {
+            moves_[event->cookie] = PendingMove{path, directory};
+        } else if (event->mask & IN_MOVED_TO) {
+            auto move = moves_.find(event->cookie);
+            if (move != moves_.end()) {
+                if (directory) {
+                    renameSubtree(move->second.path, path);
+                } else {
+                    removeFile(move->second.path);
+                    updateFile(path);
+                }
+                moves_.erase(move);
+            } else if (directory) {
+                scanSubtree(path);
+            } else {
+                updateFile(path);
+            }
+        } else if (event->mask & IN_DELETE) {
+            if (directory) {
+                removeSubtree(path);
+            } else {
+                removeFile(path);
+            }
+        } else if (directory) {
+            if (event->mask & IN_CREATE) {
+                scanSubtree(path);
+            }
+        } else {
+            updateFile(path);
+        }
+    }
+#else
+    (void)buffer;
+    (void)length;
+#endif
+}
+
+void WatchDaemon::flushMoves() {
+    for (const auto& [cookie, move] : moves_) {
+        if (move.directory) {
+            removeSubtree(move.path);
+        } else {
+            removeFile(move.path);
+        }
+    }
+    moves_.clear();
+}
+
+void WatchDaemon::emitCheckpoint(const Checkpoint& checkpoint) {
+    std::vector<WalkEntry> files;
+    files.reserve(files_.size());
+    for (const auto& [path, entry] : files_) {
+        files.push_back(entry);
+    }
+
+    std::vector<WalkEntry> changed;
+    changed.reserve(changed_.size());
+    for (const auto& path : changed_) {
+        auto it = files_.find(path);
+        if (it != files_.end()) {
+            changed.push_back(it->second);
+        }
+    }
+
+    checkpoint(files, changed);
+    changed_.clear();
+    dirty_ = false;
+}
@@ -0,0 +1,82 @@
+//
+//  WatchDaemon.h
+//  SeekFS
+//
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <filesystem>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "DirectoryWalker.h"
+
+namespace fs = std::filesystem;
+
+// Таблица файлов дерева, которую поддерживают события inotify: после
+// первого обхода добавления, удаления и переименования применяются по
+// одному, а заново обходится только новая или перенесённая извне
+// директория. При переполнении очереди событий inotify не сообщает,
+// что потеряно, поэтому дерево обходится заново целиком.
+class WatchDaemon {
+public:
+    // files - вся таблица по возрастанию пути, changed - файлы,
+    // добавленные или изменённые после прошлой контрольной точки
+    using Checkpoint = std::function<void(const std::vector<WalkEntry>& files,
+                                          const std::vector<WalkEntry>& changed)>;
+
+    WatchDaemon(fs::path root, int num_threads = 4);
+    ~WatchDaemon();
+
+    WatchDaemon(const WatchDaemon&) = delete;
+    WatchDaemon& operator=(const WatchDaemon&) = delete;
+
+    void setFilter(DirectoryWalker::FileFilter filter) { filter_ = std::move(filter); }
+    void setMaxFileSize(uintmax_t max_size) { max_file_size_ = max_size; }
+
+    static bool supported();
+
+    // Обходит дерево и применяет события, пока stop не станет true.
+    // checkpoint вызывается сразу после обхода, затем не чаще interval и
+    // только если таблица изменилась, и ещё раз при остановке.
+    // Бросает std::runtime_error, если inotify недоступен
+    void run(const std::atomic<bool>& stop, std::chrono::milliseconds interval,
+             const Checkpoint& checkpoint);
+
+    size_t fileCount() const { return files_.size(); }
+    size_t fullRescans() const { return full_rescans_; }
+
+private:
+    struct PendingMove {
+        std::string path;
+        bool directory;
+    };
+
+    fs::path root_;
+    int num_threads_;
+    uintmax_t max_file_size_ = UINTMAX_MAX;
+    DirectoryWalker::FileFilter filter_;
+
+    int fd_ = -1;
+    std::map<std::string, WalkEntry> files_;
+    std::unordered_map<int, std::string> watch_dirs_;   // wd -> директория
+    std::map<std::string, int> dir_watches_;            // директория -> wd
+    std::unordered_set<std::string> changed_;
+    std::unordered_map<uint32_t, PendingMove> moves_;   // cookie -> источник
+    bool dirty_ = false;
+    size_t full_rescans_ = 0;
+
+    void rescanAll();
+    void scanSubtree(const std::string& dir);
+    void removeSubtree(const std::string& dir);
+    void renameSubtree(const std::string& from, const std::string& to);
+    void updateFile(const std::string& path);
+    void removeFile(const std::string& path);
+    void processEvents(const char* buffer, size_t length);
+    void flushMoves();
+    void emitCheckpoint(const Checkpoint& checkpoint);
+};
@@ -0,0 +1,335 @@
+//
+//  XXH3.cpp
+//  SeekFS
+//
+#include "XXH3.h"
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+    constexpr uint64_t PRIME32_1 = 0x9E3779B1U;
+    constexpr uint64_t PRIME32_2 = 0x85EBCA77U;
+    constexpr uint64_t PRIME32_3 = 0xC2B2AE3DU;
+    constexpr uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+    constexpr uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+    constexpr uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+    constexpr uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+    constexpr uint64_t PRIME_MX1 = 0x165667919E3779F9ULL;
+    constexpr uint64_t PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+    constexpr size_t kStripeLength = 64;
+    constexpr size_t kSecretSize = 192;
+    constexpr size_t kSecretConsumeRate = 8;
+    constexpr size_t kStripesPerBlock = (kSecretSize - kStripeLength) / kSecretConsumeRate;
+    constexpr size_t kSecretLastAccStart = 7;
+    constexpr size_t kSecretMergeAccsStart = 11;
+    constexpr size_t kMidSizeMax = 240;
+
+    alignas(64) constexpr unsigned char kSecret[kSecretSize] = {
+        0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+        0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+        0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+        0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+        0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+        0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+        0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+        0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+        0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+        0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+        0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+        0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+    };
+
+    // Чтение little-endian через memcpy; на x86 и ARM это одна инструкция
+    uint32_t readLE32(const unsigned char* p) {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        v = __builtin_bswap32(v);
+#endif
+        return v;
+    }
+
+    uint64_t readLE64(const unsigned char* p) {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        v = __builtin_bswap64(v);
+#endif
+        return v;
+    }
+
+    uint64_t rotl64(uint64_t x, int r) {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    uint64_t swap64(uint64_t x) {
+        return ((x << 56) & 0xff00000000000000ULL) | ((x << 40) & 0x00ff000000000000ULL) |
+               ((x << 24) & 0x0000ff0000000000ULL) | ((x << 8)  & 0x000000ff00000000ULL) |
+               ((x >> 8)  & 0x00000000ff000000ULL) | ((x >> 24) & 0x0000000000ff0000ULL) |
+               ((x >> 40) & 0x000000000000ff00ULL) | ((x >> 56) & 0x00000000000000ffULL);
+    }
+
+    uint64_t mul128Fold64(uint64_t lhs, uint64_t rhs) {
+#if defined(__SIZEOF_INT128__)
+        const unsigned __int128 product = static_cast<unsigned __int128>(lhs) * rhs;
+        return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#else
+        const uint64_t lo_lo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+        const uint64_t hi_lo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+        const uint64_t lo_hi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+        const uint64_t hi_hi = (lhs >> 32) * (rhs >> 32);
+        const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+        const uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+        const uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+        return lower ^ upper;
+#endif
+    }
+
+    uint64_t xxh64Avalanche(uint64_t h) {
+        h ^= h >> 33;
+        h *= PRIME64_2;
+        h ^= h >> 29;
+        h *= PRIME64_3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    uint64_t avalanche(uint64_t h) {
+        h ^= h >> 37;
+        h *= PRIME_MX1;
+        h ^= h >> 32;
+        return h;
+    }
+
+    uint64_t rrmxmx(uint64_t h, uint64_t length) {
+        h ^= rotl64(h, 49) ^ rotl64(h, 24);
+        h *= PRIME_MX2;
+        h ^= (h >> 35) + length;
+        h *= PRIME_MX2;
+        h ^= h >> 28;
+        return h;
+    }
+
+    uint64_t mix16(const unsigned char* input, const unsigned char* secret) {
+        return mul128Fold64(readLE64(input) ^ readLE64(secret),
+                            readLE64(input + 8) ^ readLE64(secret + 8));
+    }
+
+    uint64_t hashUpTo16(const unsigned char* input, size_t length) {
+        if (length > 8) {
+            const uint64_t input_lo = readLE64(input) ^ (readLE64(kSecret + 24) ^ readLE64(kSecret + 32));
+            const uint64_t input_hi = readLE64(input + length - 8) ^ (readLE64(kSecret + 40) ^ readLE64(kSecret + 48));
+            const uint64_t acc = length + swap64(input_lo) + input_hi + mul128Fold64(input_lo, input_hi);
+            return avalanche(acc);
+        }
+        if (length >= 4) {
+            const uint64_t input1 = readLE32(input);
+            const uint64_t input2 = readLE32(input + length - 4);
+            const uint64_t keyed = (input2 + (input1 << 32)) ^ (readLE64(kSecret + 8) ^ readLE64(kSecret + 16));
+            return rrmxmx(keyed, length);
+        }
+        if (length > 0) {
+            const uint32_t combined = (static_cast<uint32_t>(input[0]) << 16) |
+                                      (static_cast<uint32_t>(input[length >> 1]) << 24) |
+                                      static_cast<uint32_t>(input[length - 1]) |
+                                      (static_cast<uint32_t>(length) << 8);
+            const uint64_t bitflip = readLE32(kSecret) ^ readLE32(kSecret + 4);
+            return xxh64Avalanche(combined ^ bitflip);
+        }
+        return xxh64Avalanche(readLE64(kSecret + 56) ^ readLE64(kSecret + 64));
+    }
+
+    uint64_t hashUpTo128(const unsigned char* input, size_t length) {
+        uint64_t acc = length * PRIME64_1;
+        if (length > 32) {
+            if (length > 64) {
+                if (length > 96) {
+                    acc += mix16(input + 48, kSecret + 96);
+                    acc += mix16(input + length - 64, kSecret + 112);
+                }
+                acc += mix16(input + 32, kSecret + 64);
+                acc += mix16(input + length - 48, kSecret + 80);
+            }
+            acc += mix16(input + 16, kSecret + 32);
+            acc += mix16(input + length - 32, kSecret + 48);
+        }
+        acc += mix16(input, kSecret);
+        acc += mix16(input + length - 16, kSecret + 16);
+        return avalanche(acc);
+    }
+
+    uint64_t hashUpTo240(const unsigned char* input, size_t length) {
+        constexpr size_t kMidSizeStartOffset = 3;
+        constexpr size_t kMidSizeLastOffset = 17;
+        constexpr size_t kSecretSizeMin = 136;
+
+        uint64_t acc = length * PRIME64_1;
+        const size_t rounds = length / 16;
+        for (size_t i = 0; i < 8; ++i) {
+            acc += mix16(input + 16 * i, kSecret + 16 * i);
+        }
+        uint64_t acc_end = mix16(input + length - 16, kSecret + kSecretSizeMin - kMidSizeLastOffset);
+        acc = avalanche(acc);
+        for (size_t i = 8; i < rounds; ++i) {
+            acc_end += mix16(input + 16 * i, kSecret + 16 * (i - 8) + kMidSizeStartOffset);
+        }
+        return avalanche(acc + acc_end);
+    }
+
+    void accumulateStripe(uint64_t* acc, const unsigned char* input, const unsigned char* secret) {
+#if defined(__SSE2__)
+        __m128i* xacc = reinterpret_cast<__m128i*>(acc);
+        for (size_t i = 0; i < 4; ++i) {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input) + i);
+            const __m128i key = _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i);
+            const __m128i data_key = _mm_xor_si128(data, key);
+            const __m128i data_key_hi = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+            const __m128i product = _mm_mul_epu32(data_key, data_key_hi);
+            const __m128i data_swap = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+            xacc[i] = _mm_add_epi64(xacc[i], _mm_add_epi64(product, data_swap));
+        }
+#else
+        for (size_t i = 0; i < 8; ++i) {
+            const uint64_t data = readLE64(input + 8 * i);
+            const uint64_t data_key = data ^ readLE64(secret + 8 * i);
+            acc[i ^ 1] += data;
+            acc[i] += (data_key & 0xFFFFFFFF) * (data_key >> 32);
+        }
+#endif
+    }
+
+    void scramble(uint64_t* acc, const unsigned char* secret) {
+        for (size_t i = 0; i < 8; ++i) {
+            uint64_t a = acc[i];
+            a ^= a >> 47;
+            a ^= readLE64(secret + 8 * i);
+            a *= PRIME32_1;
+            acc[i] = a;
+        }
+    }
+
+    uint64_t mergeAccumulators(const uint64_t* acc, uint64_t start) {
+        const unsigned char* secret = kSecret + kSecretMergeAccsStart;
+        uint64_t result = start;
+        for (size_t i = 0; i < 4; ++i) {
+            result += mul128Fold64(acc[2 * i] ^ readLE64(secret + 16 * i),
+                                   acc[2 * i + 1] ^ readLE64(secret + 16 * i + 8));
+        }
+        return avalanche(result);
+    }
+
+    void initAccumulators(uint64_t* acc) {
+        const uint64_t init[8] = {PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3,
+                                  PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1};
+        std::memcpy(acc, init, sizeof(init));
+    }
+}
+
+XXH3::XXH3() {
+    initAccumulators(acc_);
+}
+
+uint64_t XXH3::hash(const unsigned char* data, size_t length) {
+    if (length <= 16) return hashUpTo16(data, length);
+    if (length <= 128) return hashUpTo128(data, length);
+    if (length <= kMidSizeMax) return hashUpTo240(data, length);
+
+    XXH3 state;
+    state.update(data, length);
+    return state.digest();
+}
+
+void XXH3::consumeStripes(const unsigned char* input, size_t stripes) {
+    // Каждая полоса блока берёт свой сдвиг секрета; после блока аккумуляторы перемешиваются
+    while (stripes > 0) {
+        const size_t count = std::min(stripes, kStripesPerBlock - stripes_in_block_);
+        for (size_t i = 0; i < count; ++i) {
+            accumulateStripe(acc_, input + i * kStripeLength,
+                             kSecret + (stripes_in_block_ + i) * kSecretConsumeRate);
+        }
+        input += count * kStripeLength;
+        stripes -= count;
+        stripes_in_block_ += count;
+
+        if (stripes_in_block_ == kStripesPerBlock) {
+            scramble(acc_, kSecret + kSecretSize - kStripeLength);
+            stripes_in_block_ = 0;
+        }
+    }
+}
+
+void XXH3::update(const unsigned char* data, size_t length) {
+    total_length_ += length;
+
+    if (buffered_ + length <= kBufferSize) {
+        if (length > 0) std::memcpy(buffer_ + buffered_, data, length);
+        buffered_ += length;
+        return;
+    }
+
+    // В буфере всегда остаётся хотя бы один байт: последняя полоса
+    // обрабатывается в digest() отдельно
+    if (buffered_ > 0) {
+        const size_t fill = kBufferSize - buffered_;
+        std::memcpy(buffer_ + buffered_, data, fill);
+        data += fill;
+        length -= fill;
+        consumeStripes(buffer_, kBufferSize / kStripeLength);
+        buffered_ = 0;
+    }
+
+    if (length > kBufferSize) {
+        const size_t stripes = (length - 1) / kStripeLength;
+        consumeStripes(data, stripes);
+        data += stripes * kStripeLength;
+        length -= stripes * kStripeLength;
+        // Хвост последней полосы нужен, если в буфере останется меньше 64 байт
+        std::memcpy(buffer_ + kBufferSize - kStripeLength, data - kStripeLength, kStripeLength);
+    }
+
+    std::memcpy(buffer_, data, length);
+    buffered_ = length;
+}
+
+uint64_t XXH3::digest() {
+    if (total_length_ <= kMidSizeMax) {
+        return hash(buffer_, buffered_);
+    }
+
+    uint64_t acc[8];
+    std::memcpy(acc, acc_, sizeof(acc));
+    const size_t saved_stripes = stripes_in_block_;
+
+    unsigned char last_stripe[kStripeLength];
+    const unsigned char* last = last_stripe;
+    if (buffered_ >= kStripeLength) {
+        consumeStripes(buffer_, (buffered_ - 1) / kStripeLength);
+        last = buffer_ + buffered_ - kStripeLength;
+    } else {
+        const size_t catchup = kStripeLength - buffered_;
+        std::memcpy(last_stripe, buffer_ + kBufferSize - catchup, catchup);
+        std::memcpy(last_stripe + catchup, buffer_, buffered_);
+    }
+    accumulateStripe(acc_, last, kSecret + kSecretSize - kStripeLength - kSecretLastAccStart);
+    const uint64_t result = mergeAccumulators(acc_, total_length_ * PRIME64_1);
+
+    // Состояние восстанавливается, чтобы после digest() можно было продолжать update()
+    std::memcpy(acc_, acc, sizeof(acc));
+    stripes_in_block_ = saved_stripes;
+    return result;
+}
+
+Digest XXH3::finalize() {
+    const uint64_t result = digest();
+    unsigned char bytes[8];
+    for (int i = 0; i < 8; ++i) {
+        bytes[i] = static_cast<unsigned char>(result >> (56 - 8 * i));
+    }
+    return Digest(bytes, sizeof(bytes));
+}
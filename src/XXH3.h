@@ -0,0 +1,32 @@
+//
+//  XXH3.h
+//  SeekFS
+//
+#pragma once
+#include "Hasher.h"
+#include <cstdint>
+
+// XXH3-64 с нулевым seed и секретом по умолчанию, совместим с xxhash 0.8.
+// Длинные входы обрабатываются полосами по 64 байта в восьми 64-битных
+// аккумуляторах; на x86 используется SSE2.
+class XXH3 : public Hasher {
+public:
+    XXH3();
+    void update(const unsigned char* data, size_t length) override;
+    Digest finalize() override;
+    std::unique_ptr<Hasher> clone() const override { return std::make_unique<XXH3>(*this); }
+
+    uint64_t digest();
+    static uint64_t hash(const unsigned char* data, size_t length);
+
+private:
+    static constexpr size_t kBufferSize = 256;
+
+    alignas(16) uint64_t acc_[8];
+    alignas(16) unsigned char buffer_[kBufferSize];
+    size_t buffered_ = 0;
+    size_t stripes_in_block_ = 0;
+    uint64_t total_length_ = 0;
+
+    void consumeStripes(const unsigned char* input, size_t stripes);
+};
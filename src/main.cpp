@@ -10,6 +10,11 @@
 #include <string>
 #include <filesystem>
 #include <thread>
+#include <fstream>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <csignal>
 #include "cxxopts.hpp"
 #include "FileSearcher.h"
 #include "GraphicsUtils.h"
@@ -17,6 +22,31 @@
 using namespace std;
 namespace fs = filesystem;
 
+static atomic<bool> stop_requested{false};
+
+static void requestStop(int) {
+    stop_requested = true;
+}
+
+static vector<string> loadPatterns(const string& path) {
+    ifstream stream(path);
+    if (!stream) {
+        throw runtime_error("Cannot open pattern file: " + path);
+    }
+    
+    vector<string> patterns;
+    string line;
+    while (getline(stream, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            patterns.push_back(line);
+        }
+    }
+    return patterns;
+}
+
 int main(int argc, char** argv) {
     cxxopts::Options options("SeekFS", "🎯 Advanced file search utility - Modern C++17/20");
     
@@ -24,9 +54,27 @@ int main(int argc, char** argv) {
         ("p,path", "Search path", cxxopts::value<std::string>()->default_value("."))
         ("n,name", "File name pattern (regex)", cxxopts::value<std::string>())
         ("c,content", "Content pattern (regex)", cxxopts::value<std::string>())
+        ("patterns", "File with content patterns, one per line (single pass)", cxxopts::value<std::string>())
         ("d,duplicates", "Find duplicate files by hash")
         ("i,ignore-case", "Case insensitive search")
         ("progress", "Show progress visualization")
+        ("stream", "Print matches as soon as they are found")
+        ("lines", "Report matching lines as path:line:offset:text")
+        ("max-count", "Stop reading a file after N matching lines (with --lines)", cxxopts::value<size_t>()->default_value("0"))
+        ("max-results", "Stop the whole search after N matching lines (with --lines)", cxxopts::value<size_t>()->default_value("0"))
+        ("binary", "Binary files in content search: skip, text or match", cxxopts::value<std::string>()->default_value("skip"))
+        ("hash", "Duplicate hash: md5, xxh3 or blake3", cxxopts::value<std::string>()->default_value("md5"))
+        ("hash-cache", "Reuse duplicate hashes between runs via this cache file", cxxopts::value<std::string>())
+        ("build-index", "Walk the path and write a file name index to FILE", cxxopts::value<std::string>())
+        ("index", "Answer -n from this name index instead of walking the path", cxxopts::value<std::string>())
+        ("build-content-index", "Walk the path and write a content trigram index to FILE", cxxopts::value<std::string>())
+        ("content-index", "Read only candidate and changed files for -c using this content index", cxxopts::value<std::string>())
+        ("dir-snapshot", "Reuse unchanged directory listings between runs via this file", cxxopts::value<std::string>())
+        ("watch", "Keep --index and --hash-cache current via inotify until interrupted")
+        ("checkpoint", "Seconds between --watch checkpoints", cxxopts::value<int>()->default_value("30"))
+        ("similar", "Find files sharing content-defined chunks (near duplicates)")
+        ("min-shared", "Minimum shared fraction of the smaller file for --similar", cxxopts::value<double>()->default_value("0.5"))
+        ("reflinks", "Detect duplicates that already share extents (FIEMAP, Linux)")
         ("t,threads", "Number of threads", cxxopts::value<int>()->default_value("4"))
         ("max-size", "Max file size in MB", cxxopts::value<size_t>()->default_value("100"))
         ("type", "File extensions (comma separated)", cxxopts::value<std::string>())
@@ -42,7 +90,21 @@ int main(int argc, char** argv) {
             cout << "\n📚 Examples:\n";
             cout << "  " << argv[0] << " -n \".*\\.txt$\"\n";
             cout << "  " << argv[0] << " -c \"TODO\" -i --progress\n";
+            cout << "  " << argv[0] << " -c \"ERROR\" --stream -p /var/log\n";
+            cout << "  " << argv[0] << " --patterns keywords.txt -i\n";
+            cout << "  " << argv[0] << " -c \"req-[0-9]+\" --lines --max-results 10\n";
+            cout << "  " << argv[0] << " -c \"GLIBC_2\" --lines --binary match\n";
             cout << "  " << argv[0] << " -d -t 8 --progress\n";
+            cout << "  " << argv[0] << " -d --reflinks\n";
+            cout << "  " << argv[0] << " -d --hash xxh3\n";
+            cout << "  " << argv[0] << " -d --hash-cache ~/.cache/seekfs/hashes\n";
+            cout << "  " << argv[0] << " --build-index ~/.cache/seekfs/names -p ~\n";
+            cout << "  " << argv[0] << " -n \"report.*\\.pdf$\" --index ~/.cache/seekfs/names\n";
+            cout << "  " << argv[0] << " --build-content-index ~/.cache/seekfs/content -p ~/src\n";
+            cout << "  " << argv[0] << " -c \"parseConfig\" --content-index ~/.cache/seekfs/content -p ~/src\n";
+            cout << "  " << argv[0] << " -d --dir-snapshot ~/.cache/seekfs/dirs --hash-cache ~/.cache/seekfs/hashes\n";
+            cout << "  " << argv[0] << " --watch --index ~/.cache/seekfs/names --hash-cache ~/.cache/seekfs/hashes -p ~\n";
+            cout << "  " << argv[0] << " --similar --min-shared 0.8 -p /var/lib/images\n";
             return 0;
         }
 
@@ -65,16 +127,83 @@ int main(int argc, char** argv) {
             return 1;
         }
         
+        const string binary_mode = result["binary"].as<string>();
+        if (binary_mode != "skip" && binary_mode != "text" && binary_mode != "match") {
+            cerr << "❌ Error: --binary must be one of skip, text, match\n";
+            return 1;
+        }
+        
+        const string hash_name = result["hash"].as<string>();
+        if (hash_name != "md5" && hash_name != "xxh3" && hash_name != "blake3") {
+            cerr << "❌ Error: --hash must be one of md5, xxh3, blake3\n";
+            return 1;
+        }
+        
+        const double min_shared = result["min-shared"].as<double>();
+        if (min_shared < 0.0 || min_shared > 1.0) {
+            cerr << "❌ Error: --min-shared must be between 0 and 1\n";
+            return 1;
+        }
+        
         if (max_size_mb == 0) {
             cerr << "❌ Error: The maximum file size must be greater than 0\n";
             return 1;
         }
+        
+        if ((result.count("max-count") || result.count("max-results")) && !result.count("lines")) {
+            cerr << "❌ Error: --max-count and --max-results work only with --lines\n";
+            return 1;
+        }
+        
+        // Каждый режим вывода поддерживает только свои флаги: молча
+        // отброшенный флаг обернулся бы, например, полным обходом вместо индекса
+        const char* conflict = nullptr;
+        if (result.count("patterns") && result.count("content")) {
+            conflict = "--patterns cannot be combined with -c, add the pattern to the file";
+        } else if (result.count("patterns") &&
+                   (result.count("lines") || result.count("content-index") || result.count("stream"))) {
+            conflict = "--patterns cannot be combined with --lines, --content-index or --stream";
+        } else if (result.count("lines") && !result.count("content")) {
+            conflict = "--lines needs -c";
+        } else if (result.count("lines") && (result.count("content-index") || result.count("stream"))) {
+            conflict = "--lines cannot be combined with --content-index or --stream";
+        } else if (result.count("content-index") && !result.count("content")) {
+            conflict = "--content-index needs -c";
+        } else if (result.count("content-index") && result.count("stream")) {
+            conflict = "--content-index cannot be combined with --stream";
+        } else if (result.count("index") && result.count("stream") && result.count("name")) {
+            conflict = "--index cannot be combined with --stream";
+        }
+        if (conflict) {
+            cerr << "❌ Error: " << conflict << "\n";
+            return 1;
+        }
 
         bool show_progress = result.count("progress");
+        bool stream_results = result.count("stream");
         
         FileSearcher searcher(search_path, num_threads, show_progress);
         searcher.setCaseSensitive(!result.count("ignore-case"));
         searcher.setMaxFileSize(max_size_mb * 1024 * 1024);
+        searcher.setMaxCount(result["max-count"].as<size_t>());
+        searcher.setMaxResults(result["max-results"].as<size_t>());
+        if (binary_mode == "text") {
+            searcher.setBinaryMode(FileSearcher::BinaryMode::Text);
+        } else if (binary_mode == "match") {
+            searcher.setBinaryMode(FileSearcher::BinaryMode::MatchOnly);
+        }
+        searcher.setDetectSharedExtents(result.count("reflinks"));
+        if (result.count("hash-cache")) {
+            searcher.setHashCacheFile(result["hash-cache"].as<string>());
+        }
+        if (result.count("dir-snapshot")) {
+            searcher.setDirectorySnapshotFile(result["dir-snapshot"].as<string>());
+        }
+        if (hash_name == "xxh3") {
+            searcher.setHashAlgorithm(HashAlgorithm::XXH3);
+        } else if (hash_name == "blake3") {
+            searcher.setHashAlgorithm(HashAlgorithm::BLAKE3);
+        }
         
         if (result.count("type")) {
             try {
@@ -93,20 +222,89 @@ int main(int argc, char** argv) {
             }
         }
 
+        if (result.count("watch")) {
+            if (!result.count("index") && !result.count("hash-cache")) {
+                cerr << "❌ Error: --watch needs --index and/or --hash-cache\n";
+                return 1;
+            }
+            const int checkpoint = result["checkpoint"].as<int>();
+            if (checkpoint < 1) {
+                cerr << "❌ Error: --checkpoint must be a positive number of seconds\n";
+                return 1;
+            }
+            
+            GraphicsUtils::printHeader("WATCH MODE");
+            cout << "Watching " << search_path << ", press Ctrl+C to stop" << endl;
+            signal(SIGINT, requestStop);
+            signal(SIGTERM, requestStop);
+            
+            try {
+                const string index_file = result.count("index") ? result["index"].as<string>() : string();
+                searcher.watch(index_file, chrono::seconds(checkpoint), stop_requested);
+                cout << "✅ Watch stopped, indexes are up to date\n";
+            } catch (const exception& e) {
+                cerr << "❌ Error in watch mode: " << e.what() << endl;
+                return 1;
+            }
+            return 0;
+        }
+
         bool found_any = false;
         bool search_successful = true;
 
+        if (result.count("build-index")) {
+            found_any = true;
+            GraphicsUtils::printHeader("NAME INDEX");
+            
+            try {
+                const string index_file = result["build-index"].as<string>();
+                size_t indexed = searcher.buildNameIndex(index_file);
+                cout << "✅ Indexed files: " << indexed << " -> " << index_file << endl;
+            } catch (const exception& e) {
+                cerr << "❌ Error when building the name index: " << e.what() << endl;
+                search_successful = false;
+            }
+        }
+
+        if (result.count("build-content-index")) {
+            found_any = true;
+            GraphicsUtils::printHeader("CONTENT INDEX");
+            
+            try {
+                const string index_file = result["build-content-index"].as<string>();
+                size_t indexed = searcher.buildContentIndex(index_file);
+                cout << "✅ Indexed files: " << indexed << " -> " << index_file << endl;
+            } catch (const exception& e) {
+                cerr << "❌ Error when building the content index: " << e.what() << endl;
+                search_successful = false;
+            }
+        }
+
         if (result.count("name")) {
             found_any = true;
             GraphicsUtils::printHeader("NAME SEARCH");
             cout << "Pattern: " << result["name"].as<string>() << endl;
             
             try {
-                auto files = searcher.searchByName(result["name"].as<string>());
-                if (files.empty()) {
-                    cout << "🔍 Files according to the specified template were not found\n";
+                if (result.count("index")) {
+                    auto files = searcher.searchByNameIndexed(result["name"].as<string>(),
+                                                              result["index"].as<string>());
+                    if (files.empty()) {
+                        cout << "🔍 Files according to the specified template were not found\n";
+                    } else {
+                        GraphicsUtils::printFileTree(files, "📁 Matching Files");
+                    }
+                } else if (stream_results) {
+                    size_t matches = searcher.searchByName(result["name"].as<string>(),
+                        [](const string& file) { cout << file << '\n'; });
+                    cout << "🔍 Matching files: " << matches << endl;
                 } else {
-                    GraphicsUtils::printFileTree(files, "📁 Matching Files");
+                    auto files = searcher.searchByName(result["name"].as<string>());
+                    if (files.empty()) {
+                        cout << "🔍 Files according to the specified template were not found\n";
+                    } else {
+                        GraphicsUtils::printFileTree(files, "📁 Matching Files");
+                    }
                 }
             } catch (const exception& e) {
                 cerr << "❌ Error when searching by name: " << e.what() << endl;
@@ -114,17 +312,70 @@ int main(int argc, char** argv) {
             }
         }
         
-        if (result.count("content")) {
+        if (result.count("patterns")) {
+            found_any = true;
+            GraphicsUtils::printHeader("MULTI-PATTERN SEARCH");
+            
+            try {
+                auto patterns = loadPatterns(result["patterns"].as<string>());
+                cout << "Patterns: " << patterns.size() << endl;
+                
+                auto hits = searcher.searchByContent(patterns);
+                if (hits.empty()) {
+                    cout << "🔍 Files with the specified content were not found\n";
+                } else {
+                    vector<string> lines;
+                    lines.reserve(hits.size());
+                    for (const auto& hit : hits) {
+                        string line = hit.path + "  [";
+                        for (size_t i = 0; i < hit.patterns.size(); ++i) {
+                            if (i > 0) line += ", ";
+                            line += patterns[hit.patterns[i]];
+                        }
+                        lines.push_back(line + "]");
+                    }
+                    GraphicsUtils::printFileTree(lines, "📄 Files with Matching Patterns");
+                }
+            } catch (const exception& e) {
+                cerr << "❌ Error when searching by content: " << e.what() << endl;
+                search_successful = false;
+            }
+        } else if (result.count("content")) {
             found_any = true;
             GraphicsUtils::printHeader("CONTENT SEARCH");
             cout << "Pattern: " << result["content"].as<string>() << endl;
             
             try {
-                auto files = searcher.searchByContent(result["content"].as<string>());
-                if (files.empty()) {
-                    cout << "🔍 Files with the specified content were not found\n";
+                if (result.count("lines")) {
+                    size_t matches = searcher.reportMatches(result["content"].as<string>(),
+                        [](const FileSearcher::ContentMatch& match) {
+                            if (match.binary) {
+                                cout << "Binary file " << match.path << " matches\n";
+                                return;
+                            }
+                            cout << match.path << ':' << match.line_number << ':'
+                                 << match.byte_offset << ':' << match.line << '\n';
+                        });
+                    cout << "🔍 Matching lines: " << matches << endl;
+                } else if (result.count("content-index")) {
+                    auto files = searcher.searchByContentIndexed(result["content"].as<string>(),
+                                                                 result["content-index"].as<string>());
+                    if (files.empty()) {
+                        cout << "🔍 Files with the specified content were not found\n";
+                    } else {
+                        GraphicsUtils::printFileTree(files, "📄 Files with Matching Content");
+                    }
+                } else if (stream_results) {
+                    size_t matches = searcher.searchByContent(result["content"].as<string>(),
+                        [](const string& file) { cout << file << '\n'; });
+                    cout << "🔍 Files with matching content: " << matches << endl;
                 } else {
-                    GraphicsUtils::printFileTree(files, "📄 Files with Matching Content");
+                    auto files = searcher.searchByContent(result["content"].as<string>());
+                    if (files.empty()) {
+                        cout << "🔍 Files with the specified content were not found\n";
+                    } else {
+                        GraphicsUtils::printFileTree(files, "📄 Files with Matching Content");
+                    }
                 }
             } catch (const exception& e) {
                 cerr << "❌ Error when searching by content: " << e.what() << endl;
@@ -135,18 +386,50 @@ int main(int argc, char** argv) {
         if (result.count("duplicates")) {
             found_any = true;
             try {
-                auto duplicates = searcher.findDuplicates();
-                if (duplicates.empty()) {
+                auto report = searcher.findDuplicateReport();
+                if (report.duplicates.empty()) {
                     cout << "✅ No duplicate files found\n";
                 } else {
-                    GraphicsUtils::printDuplicateGroups(duplicates);
+                    GraphicsUtils::printDuplicateGroups(report.duplicates);
+                }
+                if (!report.hardlinks.empty()) {
+                    GraphicsUtils::printLinkGroups(report.hardlinks, "Hard Link Group (same inode, no extra space)");
+                }
+                if (!report.shared_extents.empty()) {
+                    GraphicsUtils::printLinkGroups(report.shared_extents, "Shared Extents Group (reflinked copies)");
                 }
+                cout << "\n💾 Reclaimable: " << std::fixed << std::setprecision(2)
+                     << report.reclaimable_bytes / (1024.0 * 1024.0) << " MB\n";
             } catch (const exception& e) {
                 cerr << "❌ Error when searching for duplicates: " << e.what() << endl;
                 search_successful = false;
             }
         }
 
+        if (result.count("similar")) {
+            found_any = true;
+            try {
+                auto report = searcher.findSimilarFiles(min_shared);
+                if (report.pairs.empty()) {
+                    cout << "✅ No similar files found\n";
+                } else {
+                    GraphicsUtils::printSimilarPairs(report.pairs);
+                }
+                cout << "\n💾 Reclaimable with chunk-level dedup: " << std::fixed << std::setprecision(2)
+                     << report.reclaimable_bytes / (1024.0 * 1024.0) << " MB of "
+                     << report.total_bytes / (1024.0 * 1024.0) << " MB\n";
+                if (report.common_chunks > 0) {
+                    cout << "ℹ️  " << report.common_chunks << " chunks shared by more than "
+                         << FileSearcher::kMaxChunkFanout << " files ("
+                         << report.common_reclaimable_bytes / (1024.0 * 1024.0)
+                         << " MB reclaimable) are counted above but not attributed to pairs\n";
+                }
+            } catch (const exception& e) {
+                cerr << "❌ Error when searching for similar files: " << e.what() << endl;
+                search_successful = false;
+            }
+        }
+
         if (!found_any) {
             GraphicsUtils::printHeader("INFO");
             cout << "❓ No search criteria specified. Use -h for help.\n";
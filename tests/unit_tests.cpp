@@ -8,6 +8,23 @@
 #include <gtest/gtest.h>
 #include "FileSearcher.h"
 #include "HashCalculator.h"
+#include "FileComparator.h"
+#include "BLAKE3.h"
+#include "AsyncReader.h"
+#include "ContentChunker.h"
+#include "WatchDaemon.h"
+#include "PathTable.h"
+#include "ThreadPool.h"
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <set>
+#include <map>
+#include <regex>
+#include <atomic>
+#include "LiteralPrefilter.h"
+#include "RegexEngine.h"
 
 class FileSearcherTest : public ::testing::Test {
 protected:
@@ -35,6 +52,83 @@ TEST_F(FileSearcherTest, SearchByContent) {
     EXPECT_EQ(results.size(), 2);
 }
 
+TEST_F(FileSearcherTest, StreamingSearchByContent) {
+    FileSearcher searcher("test_dir", 2);
+    std::vector<std::string> streamed;
+    auto count = searcher.searchByContent("test", [&streamed](const std::string& file) {
+        streamed.push_back(file);
+    });
+    EXPECT_EQ(count, 2);
+    EXPECT_EQ(streamed.size(), 2);
+}
+
+TEST_F(FileSearcherTest, MultiPatternSearch) {
+    FileSearcher searcher("test_dir");
+    auto hits = searcher.searchByContent(std::vector<std::string>{"different", "test", "cont[a-z]+t"});
+    ASSERT_EQ(hits.size(), 3);
+    
+    size_t with_test = 0;
+    for (const auto& hit : hits) {
+        if (hit.path.find("file2.txt") != std::string::npos) {
+            EXPECT_EQ(hit.patterns, (std::vector<size_t>{0, 2}));
+        } else {
+            EXPECT_EQ(hit.patterns, (std::vector<size_t>{1, 2}));
+            ++with_test;
+        }
+    }
+    EXPECT_EQ(with_test, 2);
+}
+
+TEST_F(FileSearcherTest, ReportMatchingLines) {
+    std::ofstream("test_dir/log.txt") << "ok\nerror one\nok\nerror two\n";
+    
+    FileSearcher searcher("test_dir");
+    std::vector<FileSearcher::ContentMatch> matches;
+    searcher.reportMatches("error", [&matches](const FileSearcher::ContentMatch& match) {
+        matches.push_back(match);
+    });
+    ASSERT_EQ(matches.size(), 2);
+    EXPECT_EQ(matches[0].line_number, 2);
+    EXPECT_EQ(matches[0].byte_offset, 3);
+    EXPECT_EQ(matches[1].line, "error two");
+    
+    searcher.setMaxResults(1);
+    EXPECT_EQ(searcher.reportMatches("error", [](const FileSearcher::ContentMatch&) {}), 1);
+}
+
+TEST_F(FileSearcherTest, BinaryFilesSkippedByDefault) {
+    std::ofstream("test_dir/blob.bin", std::ios::binary) << std::string("needle\0\x01\x02", 9);
+    std::ofstream("test_dir/text.txt") << "needle\n";
+    
+    FileSearcher searcher("test_dir");
+    EXPECT_EQ(searcher.searchByContent("needle").size(), 1);
+    
+    searcher.setBinaryMode(FileSearcher::BinaryMode::Text);
+    EXPECT_EQ(searcher.searchByContent("needle").size(), 2);
+    
+    searcher.setBinaryMode(FileSearcher::BinaryMode::MatchOnly);
+    size_t binary_records = 0;
+    searcher.reportMatches("needle", [&binary_records](const FileSearcher::ContentMatch& match) {
+        if (match.binary) ++binary_records;
+    });
+    EXPECT_EQ(binary_records, 1);
+}
+
+TEST_F(FileSearcherTest, FindDuplicatesAcrossNames) {
+    // Одинаковые начало и конец, различие только в середине большого файла
+    std::string large(64 * 1024, 'a');
+    std::ofstream("test_dir/large1.bin", std::ios::binary) << large;
+    std::ofstream("test_dir/subdir/large2.bin", std::ios::binary) << large;
+    large[large.size() / 2] = 'b';
+    std::ofstream("test_dir/large3.bin", std::ios::binary) << large;
+    
+    FileSearcher searcher("test_dir");
+    auto duplicates = searcher.findDuplicates();
+    ASSERT_EQ(duplicates.size(), 2);
+    EXPECT_EQ(duplicates[HashCalculator::calculateMD5("test_dir/file1.txt")].size(), 2);
+    EXPECT_EQ(duplicates[HashCalculator::calculateMD5("test_dir/large1.bin")].size(), 2);
+}
+
 TEST_F(FileSearcherTest, MD5Calculation) {
     auto hash1 = HashCalculator::calculateMD5("test_dir/file1.txt");
     auto hash2 = HashCalculator::calculateMD5("test_dir/file2.txt");
@@ -43,3 +137,762 @@ TEST_F(FileSearcherTest, MD5Calculation) {
     EXPECT_EQ(hash1, hash3);
     EXPECT_NE(hash1, hash2);
 }
+
+TEST_F(FileSearcherTest, HardLinksCollapsedBeforeHashing) {
+    fs::create_hard_link("test_dir/file1.txt", "test_dir/link1.txt");
+    
+    FileSearcher searcher("test_dir");
+    auto report = searcher.findDuplicateReport();
+    ASSERT_EQ(report.duplicates.size(), 1);
+    EXPECT_EQ(report.duplicates.begin()->second.size(), 2);
+    ASSERT_EQ(report.hardlinks.size(), 1);
+    EXPECT_EQ(report.hardlinks[0].size(), 2);
+    EXPECT_EQ(report.reclaimable_bytes, std::string("test content").size());
+}
+
+TEST_F(FileSearcherTest, HashCacheSurvivesReload) {
+    WalkEntry file{"test_dir/file1.txt", 12, 1, 42, 1000};
+    const Digest digest = HashCalculator::calculateHash(file.path, HashAlgorithm::MD5);
+    {
+        HashCache cache("test_dir/cache/hashes");
+        cache.store(file, HashAlgorithm::MD5, HashCache::Kind::Full, digest);
+        ASSERT_TRUE(cache.save());
+    }
+    
+    HashCache cache("test_dir/cache/hashes");
+    Digest hash;
+    ASSERT_TRUE(cache.lookup(file, HashAlgorithm::MD5, HashCache::Kind::Full, hash));
+    EXPECT_EQ(hash.hex(), HashCalculator::calculateMD5(file.path));
+    EXPECT_FALSE(cache.lookup(file, HashAlgorithm::MD5, HashCache::Kind::Partial, hash));
+    EXPECT_FALSE(cache.lookup(file, HashAlgorithm::XXH3, HashCache::Kind::Full, hash));
+    file.mtime_ns += 1;
+    EXPECT_FALSE(cache.lookup(file, HashAlgorithm::MD5, HashCache::Kind::Full, hash));
+    
+    // Запись, которую не запрашивали дольше max_age, не переживает save
+    {
+        HashCache expiring("test_dir/cache/hashes", std::chrono::nanoseconds(0));
+        ASSERT_EQ(expiring.loadedCount(), 1);
+        ASSERT_TRUE(expiring.save());
+    }
+    EXPECT_EQ(HashCache("test_dir/cache/hashes").loadedCount(), 0);
+    
+    // Заменённый файл сохраняет права, выставленные пользователем
+    fs::permissions("test_dir/cache/hashes", fs::perms::owner_read | fs::perms::owner_write);
+    ASSERT_TRUE(HashCache("test_dir/cache/hashes").save());
+    EXPECT_EQ(fs::status("test_dir/cache/hashes").permissions(), fs::perms::owner_read | fs::perms::owner_write);
+    // Временный файл записи переименован, рядом с кэшем ничего не осталось
+    EXPECT_EQ(std::distance(fs::directory_iterator("test_dir/cache"), fs::directory_iterator()), 1);
+    
+    FileSearcher searcher("test_dir");
+    searcher.setHashCacheFile("test_dir/cache/hashes");
+    auto first = searcher.findDuplicates();
+    // Хэш пары, подтверждённой побайтовым сравнением, тоже попадает в кэш
+    EXPECT_EQ(HashCache("test_dir/cache/hashes").loadedCount(), 2);
+    auto second = searcher.findDuplicates();
+    ASSERT_EQ(first.size(), 1);
+    EXPECT_EQ(first.begin()->first, second.begin()->first);
+}
+
+TEST_F(FileSearcherTest, ComparatorSplitsAtFirstDifference) {
+    const std::string big(3 * FileComparator::kChunkSize + 5, 'z');
+    std::string tail_differs = big;
+    tail_differs.back() = 'q';
+    std::ofstream("test_dir/a.bin", std::ios::binary) << big;
+    std::ofstream("test_dir/b.bin", std::ios::binary) << big;
+    std::ofstream("test_dir/c.bin", std::ios::binary) << tail_differs;
+    std::ofstream("test_dir/d.bin", std::ios::binary) << std::string(FileComparator::kChunkSize, 'z');
+    std::ofstream("test_dir/e.bin", std::ios::binary) << std::string(FileComparator::kChunkSize, 'z');
+    
+    auto groups = FileComparator::splitIdentical({"test_dir/a.bin", "test_dir/c.bin", "test_dir/missing.bin",
+                                                  "test_dir/b.bin"});
+    ASSERT_EQ(groups.size(), 1);
+    EXPECT_EQ(groups[0], (std::vector<size_t>{0, 3}));
+    
+    // Дайджест, посчитанный попутно, совпадает с хэшем файла и после деления группы
+    std::ofstream("test_dir/f.bin", std::ios::binary) << tail_differs;
+    BLAKE3 hasher;
+    auto hashed = FileComparator::splitIdentical({"test_dir/a.bin", "test_dir/c.bin", "test_dir/b.bin",
+                                                  "test_dir/f.bin"}, hasher);
+    ASSERT_EQ(hashed.size(), 2);
+    for (const auto& identical : hashed) {
+        EXPECT_EQ(identical.digest, HashCalculator::calculateHash(identical.indices[0] == 0 ? "test_dir/a.bin"
+                                                                                          : "test_dir/c.bin",
+                                                                  HashAlgorithm::BLAKE3));
+    }
+    fs::remove("test_dir/f.bin");
+    
+    groups = FileComparator::splitIdentical({"test_dir/d.bin", "test_dir/e.bin"});
+    ASSERT_EQ(groups.size(), 1);
+    EXPECT_EQ(groups[0].size(), 2);
+    
+    FileSearcher searcher("test_dir");
+    auto duplicates = searcher.findDuplicates();
+    EXPECT_EQ(duplicates.size(), 3);
+    EXPECT_EQ(duplicates.count(HashCalculator::calculateMD5("test_dir/a.bin")), 1);
+}
+
+TEST_F(FileSearcherTest, AsyncReaderDeliversChunksInOrder) {
+    std::string large;
+    for (size_t i = 0; large.size() < 3 * AsyncReader::kChunkSize + 17; ++i) {
+        large += std::to_string(i) + ',';
+    }
+    std::ofstream("test_dir/large.txt", std::ios::binary) << large;
+    std::ofstream("test_dir/empty.txt");
+    
+    const std::vector<fs::path> files = {"test_dir/large.txt", "test_dir/missing.txt", "test_dir/file1.txt",
+                                         "test_dir/empty.txt", "test_dir/file2.txt"};
+    std::vector<std::string> contents(files.size());
+    std::vector<AsyncReader::Status> statuses(files.size(), AsyncReader::Status::Failed);
+    std::vector<int> done(files.size(), 0);
+    size_t next = 0;
+    
+    AsyncReader reader(2);
+    reader.setMaxSize(large.size() - 1);
+    reader.read(
+        [&](size_t& id, fs::path& path) {
+            if (next == files.size()) return false;
+            id = next;
+            path = files[next++];
+            return true;
+        },
+        [&](size_t id, const unsigned char* data, size_t size) {
+            contents[id].append(reinterpret_cast<const char*>(data), size);
+        },
+        [&](size_t id, AsyncReader::Status status) {
+            statuses[id] = status;
+            ++done[id];
+        });
+    
+    EXPECT_EQ(done, std::vector<int>(files.size(), 1));
+    EXPECT_EQ(statuses[0], AsyncReader::Status::Skipped);
+    EXPECT_EQ(statuses[1], AsyncReader::Status::Failed);
+    EXPECT_EQ(statuses[2], AsyncReader::Status::Ok);
+    EXPECT_EQ(contents[2], "test content");
+    EXPECT_EQ(statuses[3], AsyncReader::Status::Ok);
+    EXPECT_TRUE(contents[3].empty());
+    EXPECT_EQ(contents[4], "different content");
+    
+    AsyncReader unlimited(2);
+    next = 0;
+    contents.assign(files.size(), std::string());
+    unlimited.read(
+        [&](size_t& id, fs::path& path) {
+            if (next == 1) return false;
+            id = next;
+            path = files[next++];
+            return true;
+        },
+        [&](size_t id, const unsigned char* data, size_t size) {
+            contents[id].append(reinterpret_cast<const char*>(data), size);
+        },
+        [](size_t, AsyncReader::Status) {});
+    EXPECT_EQ(contents[0], large);
+    
+    // Сбой кольца посреди чтения: начатые файлы дочитываются pread без потерь и повторов
+    AsyncReader failing(2);
+    failing.injectRingFailure(1);
+    next = 0;
+    contents.assign(files.size(), std::string());
+    done.assign(files.size(), 0);
+    failing.read(
+        [&](size_t& id, fs::path& path) {
+            if (next == files.size()) return false;
+            id = next;
+            path = files[next++];
+            return true;
+        },
+        [&](size_t id, const unsigned char* data, size_t size) {
+            contents[id].append(reinterpret_cast<const char*>(data), size);
+        },
+        [&](size_t id, AsyncReader::Status status) {
+            statuses[id] = status;
+            ++done[id];
+        });
+    EXPECT_FALSE(failing.usingIoUring());
+    EXPECT_EQ(done, std::vector<int>(files.size(), 1));
+    EXPECT_EQ(statuses[0], AsyncReader::Status::Ok);
+    EXPECT_EQ(contents[0], large);
+    EXPECT_EQ(contents[2], "test content");
+    EXPECT_EQ(contents[4], "different content");
+}
+
+TEST_F(FileSearcherTest, ChunkBoundariesSurviveInsertion) {
+    std::mt19937 rng(7);
+    std::string base(1 << 20, '\0');
+    for (auto& c : base) c = static_cast<char>(rng());
+    std::string edited = base;
+    edited.insert(300000, std::string(100, 'x'));
+    
+    auto chunk = [](const std::string& data) {
+        std::vector<std::string> chunks;
+        const auto* bytes = reinterpret_cast<const unsigned char*>(data.data());
+        for (size_t offset = 0; offset < data.size();) {
+            const size_t length = ContentChunker::nextChunk(bytes + offset, data.size() - offset);
+            EXPECT_LE(length, ContentChunker::kMaxSize);
+            if (offset + length < data.size()) {
+                EXPECT_GE(length, ContentChunker::kMinSize);
+            }
+            chunks.push_back(data.substr(offset, length));
+            offset += length;
+        }
+        return chunks;
+    };
+    auto before = chunk(base);
+    auto after = chunk(edited);
+    std::set<std::string> known(before.begin(), before.end());
+    size_t reused = 0;
+    for (const auto& c : after) reused += known.count(c);
+    EXPECT_GE(reused + 3, after.size());
+    
+    std::ofstream("test_dir/image.bin", std::ios::binary) << base;
+    std::ofstream("test_dir/image2.bin", std::ios::binary) << edited;
+    FileSearcher searcher("test_dir");
+    auto report = searcher.findSimilarFiles(0.9);
+    // Вторая пара - одинаковые file1.txt и file3.txt из SetUp
+    ASSERT_EQ(report.pairs.size(), 2);
+    EXPECT_NE(report.pairs[0].first.find("image"), std::string::npos);
+    EXPECT_GT(report.pairs[0].ratio, 0.95);
+    EXPECT_GT(report.reclaimable_bytes, base.size() * 9 / 10);
+    EXPECT_EQ(report.common_chunks, 0);
+    
+    // Чанк из слишком многих файлов не даёт пар, но остаётся в итоге
+    fs::create_directories("test_dir/common");
+    for (size_t i = 0; i <= FileSearcher::kMaxChunkFanout; ++i) {
+        std::ofstream("test_dir/common/" + std::to_string(i)) << "shared header";
+    }
+    report = searcher.findSimilarFiles(0.9);
+    EXPECT_EQ(report.pairs.size(), 2);
+    EXPECT_EQ(report.common_chunks, 1);
+    EXPECT_EQ(report.common_reclaimable_bytes, FileSearcher::kMaxChunkFanout * std::string("shared header").size());
+}
+
+TEST_F(FileSearcherTest, NameIndexQuery) {
+    std::ofstream("test_dir/Report.pdf") << "pdf";
+    FileSearcher searcher("test_dir");
+    ASSERT_EQ(searcher.buildNameIndex("test_dir/names.idx"), 4);
+    
+    // Триграммы без учёта регистра, окончательно решает регулярка
+    EXPECT_EQ(searcher.searchByNameIndexed("file[13]\\.txt$", "test_dir/names.idx").size(), 2);
+    EXPECT_TRUE(searcher.searchByNameIndexed("FILE", "test_dir/names.idx").empty());
+    EXPECT_EQ(searcher.searchByNameIndexed("^rep", "test_dir/names.idx").size(), 0);
+    EXPECT_EQ(searcher.searchByNameIndexed(".*", "test_dir/names.idx").size(), 4);
+    
+    searcher.setCaseSensitive(false);
+    auto results = searcher.searchByNameIndexed("^rep.*pdf", "test_dir/names.idx");
+    ASSERT_EQ(results.size(), 1);
+    EXPECT_EQ(fs::path(results[0]).filename(), "Report.pdf");
+    
+    std::ofstream("test_dir/broken.idx") << "not an index";
+    EXPECT_THROW(NameIndex("test_dir/broken.idx"), std::runtime_error);
+}
+
+TEST_F(FileSearcherTest, ContentIndexQuery) {
+    std::ofstream("test_dir/binary.bin", std::ios::binary) << std::string("test\0content", 12);
+    FileSearcher searcher("test_dir");
+    ASSERT_EQ(searcher.buildContentIndex("index/content.idx"), 4);
+    
+    EXPECT_EQ(searcher.searchByContentIndexed("test", "index/content.idx").size(), 2);
+    EXPECT_EQ(searcher.searchByContentIndexed("diff[a-z]+", "index/content.idx").size(), 1);
+    EXPECT_TRUE(searcher.searchByContentIndexed("missing", "index/content.idx").empty());
+    
+    // Записи ищутся от канонического корня: файл, изменённый без смены
+    // размера и mtime, индекс считает прежним при любом написании -p
+    const auto mtime = fs::last_write_time("test_dir/file2.txt");
+    std::ofstream("test_dir/file2.txt") << "testerent content";
+    fs::last_write_time("test_dir/file2.txt", mtime);
+    for (const fs::path& root : {fs::path("./test_dir"), fs::absolute("test_dir"), fs::path("test_dir/")}) {
+        EXPECT_EQ(FileSearcher(root.string()).searchByContentIndexed("test", "index/content.idx").size(), 2) << root;
+    }
+    
+    // Изменённый и новый файлы читаются, хотя индекс о них не знает
+    std::ofstream("test_dir/file2.txt") << "test again, now longer";
+    std::ofstream("test_dir/new.txt") << "fresh test";
+    EXPECT_EQ(searcher.searchByContentIndexed("test", "index/content.idx").size(), 4);
+    
+    searcher.setBinaryMode(FileSearcher::BinaryMode::Text);
+    EXPECT_EQ(searcher.searchByContentIndexed("test", "index/content.idx").size(), 5);
+    fs::remove_all("index");
+}
+
+TEST_F(FileSearcherTest, WatchDaemonTracksChanges) {
+    if (!WatchDaemon::supported()) {
+        GTEST_SKIP() << "inotify is not available";
+    }
+    
+    std::mutex mutex;
+    std::set<std::string> table;
+    auto snapshot = [&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return table;
+    };
+    auto wait_for = [&](const std::function<bool(const std::set<std::string>&)>& ready) {
+        for (int i = 0; i < 250 && !ready(snapshot()); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        return ready(snapshot());
+    };
+    
+    std::atomic<bool> stop{false};
+    WatchDaemon daemon("test_dir", 2);
+    std::thread runner([&]() {
+        daemon.run(stop, std::chrono::milliseconds(0),
+                   [&](const std::vector<WalkEntry>& files, const std::vector<WalkEntry>&) {
+            std::lock_guard<std::mutex> lock(mutex);
+            table.clear();
+            for (const auto& file : files) {
+                table.insert(fs::path(file.path).lexically_relative("test_dir").generic_string());
+            }
+        });
+    });
+    
+    EXPECT_TRUE(wait_for([](const auto& files) { return files.size() == 3; }));
+    
+    fs::create_directories("test_dir/new/deep");
+    std::ofstream("test_dir/new/deep/a.txt") << "a";
+    fs::remove("test_dir/file2.txt");
+    EXPECT_TRUE(wait_for([](const auto& files) {
+        return files.count("new/deep/a.txt") && !files.count("file2.txt");
+    }));
+    
+    // Переименование директории переносит поддерево без повторного обхода
+    fs::rename("test_dir/new", "test_dir/moved");
+    std::ofstream("test_dir/moved/deep/b.txt") << "b";
+    EXPECT_TRUE(wait_for([](const auto& files) {
+        return files == std::set<std::string>{"file1.txt", "subdir/file3.txt",
+                                              "moved/deep/a.txt", "moved/deep/b.txt"};
+    }));
+    
+    stop = true;
+    runner.join();
+    EXPECT_EQ(daemon.fullRescans(), 1);
+}
+
+TEST_F(FileSearcherTest, DirectorySnapshotSkipsUnchangedDirectories) {
+    auto walk = [](size_t& reused, size_t& rescanned, const fs::path& root = "test_dir") {
+        DirectorySnapshot snapshot("dirs.snap", std::chrono::nanoseconds(0));
+        DirectoryWalker walker(2);
+        walker.setSnapshot(&snapshot);
+        walker.setFilter([](const fs::path& file) { return file.extension() == ".txt"; });
+        
+        std::mutex mutex;
+        std::set<std::string> files;
+        walker.walk(root, [&](size_t, WalkEntry&& entry) {
+            std::lock_guard<std::mutex> lock(mutex);
+            files.insert(entry.path.lexically_relative(root).generic_string());
+        });
+        EXPECT_TRUE(snapshot.save());
+        reused = snapshot.reusedCount();
+        rescanned = snapshot.rescannedCount();
+        return files;
+    };
+    
+    size_t reused = 0;
+    size_t rescanned = 0;
+    const std::set<std::string> expected{"file1.txt", "file2.txt", "subdir/file3.txt"};
+    EXPECT_EQ(walk(reused, rescanned), expected);
+    EXPECT_EQ(reused, 0);
+    EXPECT_EQ(rescanned, 2);
+    
+    EXPECT_EQ(walk(reused, rescanned), expected);
+    EXPECT_EQ(reused, 2);
+    EXPECT_EQ(rescanned, 0);
+    
+    std::ofstream("test_dir/subdir/file4.txt") << "new";
+    auto files = walk(reused, rescanned);
+    EXPECT_TRUE(files.count("subdir/file4.txt"));
+    EXPECT_EQ(reused, 1);
+    EXPECT_EQ(rescanned, 1);
+    
+    // Директории узнаются по inode, а не по строке пути
+    EXPECT_EQ(walk(reused, rescanned, "./test_dir").size(), 4);
+    EXPECT_EQ(reused, 2);
+    EXPECT_EQ(rescanned, 0);
+    EXPECT_EQ(walk(reused, rescanned, fs::absolute("test_dir")).size(), 4);
+    EXPECT_EQ(reused, 2);
+    EXPECT_EQ(rescanned, 0);
+    
+    FileSearcher searcher("test_dir");
+    searcher.setDirectorySnapshotFile("dirs.snap");
+    EXPECT_EQ(searcher.searchByName("file.*\\.txt").size(), 4);
+    EXPECT_EQ(searcher.searchByName("file.*\\.txt").size(), 4);
+    fs::remove("dirs.snap");
+}
+
+TEST_F(FileSearcherTest, NameSearchDoesNotStatFiles) {
+    // Без размеров и лимита обход не делает stat: у записей нет ни размера, ни inode
+    DirectoryWalker walker(2);
+    std::mutex mutex;
+    std::vector<WalkEntry> entries;
+    walker.walk("test_dir", [&](size_t, WalkEntry&& entry) {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.push_back(std::move(entry));
+    });
+    ASSERT_EQ(entries.size(), 3);
+    for (const auto& entry : entries) {
+        EXPECT_EQ(entry.size, 0);
+        EXPECT_EQ(entry.inode, 0);
+    }
+    
+    // --max-size ограничивает только чтение содержимого
+    FileSearcher searcher("test_dir");
+    searcher.setMaxFileSize(4);
+    EXPECT_EQ(searcher.searchByName("file.*\\.txt").size(), 3);
+    EXPECT_TRUE(searcher.searchByContent("test").empty());
+    EXPECT_EQ(searcher.searchByContent("test", [](const std::string&) {}), 0);
+    
+    searcher.setMaxFileSize(12);
+    EXPECT_EQ(searcher.searchByContent("test").size(), 2);
+}
+
+TEST_F(FileSearcherTest, ParallelDuplicateHashingMatchesSerial) {
+    // Одна большая группа одного размера идёт через частичные и полные хэши;
+    // у части файлов совпадают начало и конец, а отличается середина
+    std::vector<fs::path> paths;
+    for (int i = 0; i < 40; ++i) {
+        std::string content(20000, static_cast<char>('a' + i % 3));
+        content[10000] = static_cast<char>('0' + i % 5);
+        paths.push_back("test_dir/big" + std::to_string(i) + ".bin");
+        std::ofstream(paths.back(), std::ios::binary) << content;
+    }
+    for (int i = 0; i < 12; ++i) {
+        paths.push_back("test_dir/subdir/small" + std::to_string(i) + ".bin");
+        std::ofstream(paths.back(), std::ios::binary) << std::string(100 + i % 2, static_cast<char>('x' + i % 3));
+    }
+    
+    using Groups = std::map<std::string, std::set<std::string>>;
+    auto normalize = [](const std::unordered_map<std::string, std::vector<std::string>>& duplicates) {
+        Groups groups;
+        for (const auto& [digest, files] : duplicates) {
+            for (const auto& file : files) {
+                groups[digest].insert(fs::path(file).lexically_relative("test_dir").generic_string());
+            }
+        }
+        return groups;
+    };
+    
+    for (auto algorithm : {HashAlgorithm::MD5, HashAlgorithm::XXH3, HashAlgorithm::BLAKE3}) {
+        // Эталон: каждый файл целиком, по одному, в вызывающем потоке
+        Groups serial;
+        for (const auto& entry : fs::recursive_directory_iterator("test_dir")) {
+            if (entry.is_regular_file()) {
+                serial[HashCalculator::calculateHash(entry.path(), algorithm).hex()]
+                    .insert(entry.path().lexically_relative("test_dir").generic_string());
+            }
+        }
+        for (auto it = serial.begin(); it != serial.end();) {
+            it = it->second.size() > 1 ? std::next(it) : serial.erase(it);
+        }
+        
+        for (int threads : {1, 8}) {
+            FileSearcher searcher("test_dir", threads);
+            searcher.setHashAlgorithm(algorithm);
+            EXPECT_EQ(normalize(searcher.findDuplicates()), serial)
+                << static_cast<int>(algorithm) << " with " << threads << " threads";
+        }
+    }
+}
+
+TEST_F(FileSearcherTest, MD5BatchMatchesScalar) {
+    std::ofstream("test_dir/block.bin", std::ios::binary) << std::string(64, 'x');
+    std::ofstream("test_dir/large.bin", std::ios::binary) << std::string(200000, 'y');
+    
+    std::vector<fs::path> files = {
+        "test_dir/file1.txt", "test_dir/block.bin", "test_dir/missing.txt",
+        "test_dir/large.bin", "test_dir/file2.txt", "test_dir/subdir/file3.txt"
+    };
+    auto hashes = HashCalculator::calculateMD5Batch(files);
+    ASSERT_EQ(hashes.size(), files.size());
+    EXPECT_TRUE(hashes[2].empty());
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (i == 2) continue;
+        EXPECT_EQ(hashes[i].hex(), HashCalculator::calculateMD5(files[i])) << files[i];
+    }
+}
+
+TEST(DirectoryWalkerTest, EveryFileSeenOnce) {
+    // Глубокая цепочка и широкие директории: работа перетекает между потоками
+    const fs::path root = "walk_tree";
+    std::set<std::string> expected;
+    fs::path deep = root;
+    for (int depth = 0; depth < 100; ++depth) {
+        deep /= "d" + std::to_string(depth);
+        fs::create_directories(deep);
+        std::ofstream(deep / "f.txt") << depth;
+        expected.insert((deep / "f.txt").lexically_relative(root).generic_string());
+    }
+    for (int dir = 0; dir < 20; ++dir) {
+        const fs::path wide = root / ("w" + std::to_string(dir));
+        fs::create_directories(wide);
+        for (int file = 0; file < 100; ++file) {
+            const fs::path path = wide / (std::to_string(file) + ".txt");
+            std::ofstream(path) << file;
+            expected.insert(path.lexically_relative(root).generic_string());
+        }
+    }
+    
+    for (int threads : {1, 4, 8}) {
+        DirectoryWalker walker(threads);
+        std::mutex mutex;
+        std::vector<std::string> seen;
+        size_t directories = 0;
+        walker.setDirectorySink([&](size_t worker, const fs::path&) {
+            EXPECT_LT(worker, walker.workerCount());
+            std::lock_guard<std::mutex> lock(mutex);
+            ++directories;
+        });
+        walker.walk(root, [&](size_t worker, WalkEntry&& entry) {
+            EXPECT_LT(worker, walker.workerCount());
+            std::lock_guard<std::mutex> lock(mutex);
+            seen.push_back(entry.path.lexically_relative(root).generic_string());
+        });
+        
+        EXPECT_EQ(seen.size(), expected.size()) << threads << " threads";
+        EXPECT_EQ(std::set<std::string>(seen.begin(), seen.end()), expected) << threads << " threads";
+        EXPECT_EQ(directories, 1 + 100 + 20) << threads << " threads";
+    }
+    
+    // Остановка: обход завершается, не дойдя до конца, и ничего не выдаёт дважды
+    std::atomic<bool> stop{false};
+    DirectoryWalker walker(4);
+    walker.setStopFlag(&stop);
+    std::mutex mutex;
+    std::set<std::string> seen;
+    size_t emitted = 0;
+    walker.walk(root, [&](size_t, WalkEntry&& entry) {
+        std::lock_guard<std::mutex> lock(mutex);
+        seen.insert(entry.path.generic_string());
+        if (++emitted == 10) {
+            stop = true;
+        }
+    });
+    EXPECT_GE(emitted, 10);
+    EXPECT_LT(emitted, expected.size());
+    EXPECT_EQ(seen.size(), emitted);
+    
+    fs::remove_all(root);
+}
+
+TEST(DirectoryWalkerTest, SymlinksWithAndWithoutDirentTypes) {
+    const fs::path root = "walk_links";
+    fs::create_directories(root / "dir");
+    std::ofstream(root / "dir" / "target.txt") << "12345";
+    fs::create_symlink("dir/target.txt", root / "file_link");
+    fs::create_symlink("dir", root / "dir_link");
+    fs::create_symlink("missing.txt", root / "dangling");
+    
+    // Ссылка на файл - это файл с размером цели; по ссылке на директорию
+    // обход не переходит, висячая ссылка пропускается
+    const std::set<std::string> expected{"dir/target.txt", "file_link"};
+    for (bool ignore_types : {false, true}) {
+        for (bool need_size : {false, true}) {
+            DirectoryWalker walker(2);
+            walker.ignoreDirentTypes(ignore_types);
+            walker.setNeedSize(need_size);
+            std::mutex mutex;
+            std::set<std::string> seen;
+            walker.walk(root, [&](size_t, WalkEntry&& entry) {
+                if (need_size) {
+                    EXPECT_EQ(entry.size, 5) << entry.path;
+                    EXPECT_NE(entry.inode, 0) << entry.path;
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                seen.insert(entry.path.lexically_relative(root).generic_string());
+            });
+            EXPECT_EQ(seen, expected) << "ignore d_type: " << ignore_types << ", size: " << need_size;
+        }
+    }
+    
+    fs::remove_all(root);
+}
+
+TEST(ThreadPoolTest, ReusedAcrossRunsAndParallelForBounds) {
+    ThreadPool pool(4);
+    ASSERT_EQ(pool.size(), 4);
+    
+    // Один и тот же пул проходит много запусков подряд, каждый worker - ровно раз
+    for (int round = 0; round < 50; ++round) {
+        std::vector<std::atomic<int>> calls(pool.size());
+        pool.run([&](size_t worker) {
+            ASSERT_LT(worker, calls.size());
+            calls[worker].fetch_add(1);
+        });
+        for (const auto& count : calls) {
+            EXPECT_EQ(count.load(), 1);
+        }
+    }
+    
+    // Каждый индекс из [0, count) выдаётся один раз при любом размере куска
+    for (size_t count : {0, 1, 3, 64, 1000, 1001}) {
+        for (size_t chunk : {0, 1, 7, 64, 5000}) {
+            std::vector<std::atomic<int>> visits(count);
+            std::atomic<size_t> bad_worker{0};
+            pool.parallelFor(count, chunk, [&](size_t worker, size_t index) {
+                if (worker >= pool.size()) bad_worker.fetch_add(1);
+                visits[index].fetch_add(1);
+            });
+            EXPECT_EQ(bad_worker.load(), 0);
+            EXPECT_TRUE(std::all_of(visits.begin(), visits.end(), [](const auto& v) { return v.load() == 1; }))
+                << count << " items, chunk " << chunk;
+        }
+    }
+    
+    // Исключение из задачи доходит до вызывающего, а пул остаётся рабочим
+    EXPECT_THROW(pool.run([](size_t worker) {
+        if (worker == 1) throw std::runtime_error("boom");
+    }), std::runtime_error);
+    std::atomic<size_t> sum{0};
+    pool.parallelFor(100, 3, [&](size_t, size_t index) { sum.fetch_add(index); });
+    EXPECT_EQ(sum.load(), 4950);
+}
+
+TEST(HasherTest, KnownDigests) {
+    auto digest = [](HashAlgorithm algorithm, const std::string& data) {
+        auto hasher = HashCalculator::createHasher(algorithm);
+        // Неровные куски проверяют буферизацию между вызовами update
+        for (size_t offset = 0; offset < data.size(); offset += 777) {
+            const size_t length = std::min<size_t>(777, data.size() - offset);
+            hasher->update(reinterpret_cast<const unsigned char*>(data.data() + offset), length);
+        }
+        return hasher->final();
+    };
+    
+    std::string large(100000, '\0');
+    for (size_t i = 0; i < large.size(); ++i) large[i] = static_cast<char>(i % 251);
+    
+    EXPECT_EQ(digest(HashAlgorithm::MD5, "abc"), "900150983cd24fb0d6963f7d28e17f72");
+    EXPECT_EQ(digest(HashAlgorithm::XXH3, ""), "2d06800538d394c2");
+    EXPECT_EQ(digest(HashAlgorithm::XXH3, "abc"), "78af5f94892f3950");
+    EXPECT_EQ(digest(HashAlgorithm::XXH3, large), "42c23aeead96750d");
+    EXPECT_EQ(digest(HashAlgorithm::BLAKE3, ""), "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262");
+    EXPECT_EQ(digest(HashAlgorithm::BLAKE3, "abc"), "6437b3ac38465133ffb63b75273a8db548c558465d79db03fd359c6cd5bd9d85");
+    EXPECT_EQ(digest(HashAlgorithm::BLAKE3, large), "d93c23eedaf165a7e0be908ba86f1a7a520d568d2d13cde787c8580c5c72cc54");
+}
+
+TEST(HasherTest, DigestEqualityAndHex) {
+    const unsigned char bytes[16] = {0x00, 0x01, 0x0f, 0x10, 0xab, 0xcd, 0xef, 0xff,
+                                     0, 0, 0, 0, 0, 0, 0, 0};
+    const Digest short_digest(bytes, 8);
+    const Digest long_digest(bytes, 16);
+    
+    // Строчный hex с ведущими нулями, ровно по size байт
+    EXPECT_EQ(short_digest.hex(), "00010f10abcdefff");
+    EXPECT_EQ(long_digest.hex(), "00010f10abcdefff0000000000000000");
+    EXPECT_EQ(Digest().hex(), "");
+    EXPECT_TRUE(Digest().empty());
+    EXPECT_FALSE(short_digest.empty());
+    
+    // Хвост нулями совпадает, но длина разная: дайджесты не равны
+    EXPECT_EQ(short_digest, Digest(bytes, 8));
+    EXPECT_NE(short_digest, long_digest);
+    EXPECT_NE(short_digest, Digest());
+    unsigned char changed[8];
+    std::memcpy(changed, bytes, sizeof(changed));
+    changed[7] ^= 1;
+    EXPECT_NE(short_digest, Digest(changed, 8));
+    
+    std::unordered_map<Digest, int, DigestHash> map;
+    map[short_digest] = 1;
+    map[long_digest] = 2;
+    map[Digest(bytes, 8)] += 10;
+    EXPECT_EQ(map.size(), 2);
+    EXPECT_EQ(map[short_digest], 11);
+    
+    // Двоичный дайджест и строковые API дают одно и то же
+    auto hasher = HashCalculator::createHasher(HashAlgorithm::MD5);
+    hasher->update(reinterpret_cast<const unsigned char*>("abc"), 3);
+    auto copy = hasher->clone();
+    const Digest md5 = hasher->finalize();
+    EXPECT_EQ(md5.size, 16);
+    EXPECT_EQ(md5.hex(), "900150983cd24fb0d6963f7d28e17f72");
+    EXPECT_EQ(copy->final(), md5.hex());
+}
+
+TEST(PathTableTest, RoundTripsPaths) {
+    const std::vector<std::string> inputs = {
+        "/data/a/readme.txt", "/data/b/readme.txt", "/data/a/main.cpp",
+        "/root.txt", "rel/dir/file.h", "file.c"
+    };
+    
+    PathTable table;
+    for (const auto& input : inputs) {
+        table.addFile(input);
+    }
+    table.seal();
+    
+    ASSERT_EQ(table.size(), inputs.size());
+    for (uint32_t id = 0; id < inputs.size(); ++id) {
+        EXPECT_EQ(table.path(id), inputs[id]);
+    }
+    EXPECT_EQ(table.name(1), "readme.txt");
+    EXPECT_EQ(table.name(5), "file.c");
+    // "/", "/data", "/data/a", "/data/b", "rel", "rel/dir" и пустой для "file.c"
+    EXPECT_EQ(table.directoryCount(), 7u);
+    
+    // Прежнее содержимое буфера заменяется, а не дополняется
+    std::string buffer = "stale";
+    table.writePath(2, buffer);
+    table.writePath(0, buffer);
+    EXPECT_EQ(buffer, inputs[0]);
+}
+
+TEST(LiteralPrefilterTest, RequiredLiterals) {
+    EXPECT_EQ(extractRequiredLiterals("TODO"), std::vector<std::string>{"TODO"});
+    EXPECT_EQ(extractRequiredLiterals("req-[0-9]+ failed"), (std::vector<std::string>{"req-", " failed"}));
+    EXPECT_EQ(extractRequiredLiterals("colou?r"), (std::vector<std::string>{"colo", "r"}));
+    EXPECT_TRUE(extractRequiredLiterals("ERROR|WARN").empty());
+    
+    LiteralFinder finder("error", false);
+    std::string text = "line one\nan ERROR here";
+    EXPECT_EQ(finder.find(text.data(), text.data() + text.size()), text.data() + 12);
+}
+
+TEST(RegexEngineTest, AutomatonMatchesStdRegex) {
+    Regex date("^[0-9]{4}-[0-9]{2}-[0-9]{2}$", true);
+    EXPECT_TRUE(date.usesAutomaton());
+    EXPECT_TRUE(date.search(std::string("2025-10-29")));
+    EXPECT_FALSE(date.search(std::string("x2025-10-29")));
+    
+    Regex icase("todo|fixme", false);
+    EXPECT_TRUE(icase.search(std::string("// FIXME: later")));
+    
+    Regex evil("(a*)*b", true);
+    EXPECT_FALSE(evil.search(std::string(10000, 'a')));
+    
+    Regex backref("(ab)\\1", true);
+    EXPECT_FALSE(backref.usesAutomaton());
+    EXPECT_TRUE(backref.search(std::string("xababx")));
+}
+
+TEST(RegexEngineTest, SharedAutomatonAcrossThreads) {
+    // Потоки достраивают общий DFA одновременно с поиском по нему
+    const std::string pattern = "[a-d]{2,5}x[a-c]*yd";
+    const std::regex reference(pattern);
+    std::mt19937 rng(7);
+    std::vector<std::string> lines(2000);
+    std::vector<char> expected(lines.size());
+    for (size_t i = 0; i < lines.size(); ++i) {
+        for (size_t n = 0; n < 40; ++n) {
+            lines[i].push_back("abcdxy"[rng() % 6]);
+        }
+        expected[i] = std::regex_search(lines[i], reference);
+    }
+    
+    Regex regex(pattern, true);
+    ASSERT_TRUE(regex.usesAutomaton());
+    std::atomic<size_t> mismatches{0};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t]() {
+            for (size_t n = 0; n < lines.size(); ++n) {
+                const size_t i = (n * 7 + t * 131) % lines.size();
+                if (regex.search(lines[i]) != static_cast<bool>(expected[i])) {
+                    mismatches.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(mismatches.load(), 0);
+}